@@ -1,7 +1,20 @@
+// The default float precision is set by the shader variant
+
 uniform sampler2D Texture;
-varying highp vec2 v_TexCoord;
+varying vec2 v_TexCoord;
+
+#ifdef CROSSFADE
+// Blends towards the next frame by the fraction of the way to it
+uniform sampler2D NextTexture;
+uniform lowp float FrameBlend;
+varying vec2 v_NextTexCoord;
+#endif
 
 void main(void)
 {
+#ifdef CROSSFADE
+	gl_FragColor = mix(texture2D(Texture, v_TexCoord), texture2D(NextTexture, v_NextTexCoord), FrameBlend);
+#else
 	gl_FragColor = texture2D(Texture, v_TexCoord);
+#endif
 }
@@ -1,13 +1,21 @@
 attribute vec3 Position;
 attribute vec2 TexCoord;
 
-uniform mat4 ProjectionMatrix;
-uniform mat4 ModelviewMatrix;
+// Projection * Modelview, combined on the CPU
+uniform mat4 MVP;
 
 varying vec2 v_TexCoord;
 
+#ifdef CROSSFADE
+attribute vec2 NextTexCoord;
+varying vec2 v_NextTexCoord;
+#endif
+
 void main(void)
 {
-	gl_Position = ProjectionMatrix * ModelviewMatrix * vec4(Position, 1.0);
+	gl_Position = MVP * vec4(Position, 1.0);
 	v_TexCoord = TexCoord;
+#ifdef CROSSFADE
+	v_NextTexCoord = NextTexCoord;
+#endif
 }
@@ -0,0 +1,9 @@
+// The default float precision is set by the shader variant
+
+uniform sampler2D Texture;
+varying vec2 v_TexCoord;
+
+void main(void)
+{
+	gl_FragColor = texture2D(Texture, v_TexCoord);
+}
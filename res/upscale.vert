@@ -0,0 +1,10 @@
+attribute vec2 Position;
+attribute vec2 TexCoord;
+
+varying vec2 v_TexCoord;
+
+void main(void)
+{
+	gl_Position = vec4(Position, 0.0, 1.0);
+	v_TexCoord = TexCoord;
+}
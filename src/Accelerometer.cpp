@@ -12,8 +12,8 @@ Accelerometer::~Accelerometer() {
 }
 
 float Accelerometer::getSingleAxisYAcceleration() {
-	Vector3f data = getRawAccelerationData();
-	return getSingleAxisAcceleration(data.magnitude(), data.y);
+	Vector4f data = getRawAccelerationData();
+	return getSingleAxisAcceleration(data.magnitudeSquared(), data.y());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -23,12 +23,9 @@ float Accelerometer::getSingleAxisYAcceleration() {
  * getRawAccelerationData
  * Returns a raw acceleration vector, with components expressed in Gs
  */
-Vector3f Accelerometer::getRawAccelerationData() {
-	Vector3f data;
-	data.x = (float) SDL_JoystickGetAxis(joy, 0) / 32768.0;
-	data.y = (float) SDL_JoystickGetAxis(joy, 1) / 32768.0;
-	data.z = (float) SDL_JoystickGetAxis(joy, 2) / 32768.0;
-	return data;
+Vector4f Accelerometer::getRawAccelerationData() {
+	Vector4f axes(SDL_JoystickGetAxis(joy, 0), SDL_JoystickGetAxis(joy, 1), SDL_JoystickGetAxis(joy, 2));
+	return axes * (1.0f / 32768.0f);
 }
 
 /*
@@ -36,14 +33,14 @@ Vector3f Accelerometer::getRawAccelerationData() {
  * Returns acceleration along a single axis, assuming no acceleration along other axes and G=1.0f
  *
  * Arguments
- *		magnitude:     Magnitude of the total acceleration vector
- *		axisComponent: Component vector of the acceleration vector for the single axis
+ *		magnitudeSquared: Squared magnitude of the total acceleration vector
+ *		axisComponent:    Component vector of the acceleration vector for the single axis
  */
-float Accelerometer::getSingleAxisAcceleration(float magnitude, float axisComponent) {
+float Accelerometer::getSingleAxisAcceleration(float magnitudeSquared, float axisComponent) {
 	const float g = 1.0f;
 
 	// gAxis^2 should never be negative obviously, but it might be barely so due to floating point error
-	float gAxis = sqrt( fabs(axisComponent * axisComponent + g * g - magnitude * magnitude) );
+	float gAxis = sqrt( fabs(axisComponent * axisComponent + g * g - magnitudeSquared) );
 	float a1 = axisComponent + gAxis;
 	float a2 = axisComponent - gAxis;
 
@@ -2,7 +2,7 @@
 #define __ACCELEROMETER_H__
 
 #include "SDL.h"
-#include "Vector3f.h"
+#include "Vector4f.h"
 
 /*
  * Animation
@@ -24,8 +24,8 @@ class Accelerometer {
 	private:
 		SDL_Joystick *joy;
 
-		Vector3f getRawAccelerationData();
-		float getSingleAxisAcceleration(float magnitude, float axisComponent);
+		Vector4f getRawAccelerationData();
+		float getSingleAxisAcceleration(float magnitudeSquared, float axisComponent);
 };
 
 #endif
@@ -0,0 +1,82 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+// Allocations by the current thread, and by every thread
+static __thread unsigned int t_Allocations = 0;
+static volatile unsigned int g_Allocations = 0;
+
+/*
+ * countedAllocate
+ * Allocates memory for operator new, counting the allocation.
+ *
+ * Returns
+ *     NULL if the allocation failed.
+ */
+static void *countedAllocate(size_t size)
+{
+	++t_Allocations;
+	__sync_fetch_and_add(&g_Allocations, 1);
+	return malloc(size > 0 ? size : 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+unsigned int AllocationCounter::threadCount()
+{
+	return t_Allocations;
+}
+
+unsigned int AllocationCounter::totalCount()
+{
+	return g_Allocations;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Global operator new and delete
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+	void *memory = countedAllocate(size);
+	if (memory == NULL) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, std::nothrow_t const&) throw()
+{
+	return countedAllocate(size);
+}
+
+void *operator new[](size_t size, std::nothrow_t const&) throw()
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void *memory) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+	free(memory);
+}
+
+void operator delete(void *memory, std::nothrow_t const&) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void *memory, std::nothrow_t const&) throw()
+{
+	free(memory);
+}
@@ -0,0 +1,19 @@
+#ifndef __ALLOCATIONCOUNTER_H__
+#define __ALLOCATIONCOUNTER_H__
+
+/*
+ * AllocationCounter
+ * Counts calls to the global operator new, which AllocationCounter.cpp
+ * replaces with counting versions. Allocations made with malloc, e.g. by
+ * SDL, aren't seen.
+ */
+class AllocationCounter {
+	public:
+		// Returns the number of allocations made by the calling thread.
+		static unsigned int threadCount();
+
+		// Returns the number of allocations made by all threads.
+		static unsigned int totalCount();
+};
+
+#endif
@@ -1,102 +1,842 @@
 #include "Animation.h"
 
+#include <cstring>
+#include <sys/stat.h>
+
+#include <GLES2/gl2ext.h>
+
+#include "Exceptions.h"
+#include "FileIO.h"
+#include "GLInfo.h"
+#include "ImageInfo.h"
+#include "TextureAtlas.h"
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public methods
 
-Animation::Animation(std::vector<std::string> frameFilenames)
+Animation::Animation(std::vector<std::string> frameFilenames, Options const& options)
 {
 	count = frameFilenames.size();
-	textures = new unsigned int[count];
-	wCoords = new float[count];
-	hCoords = new float[count];
-	aspectRatios = new float[count];
+	frames = new Frame[count];
+	npot = options.npot && GLInfo::supportsNPOT();
+	etc1 = options.compressed && GLInfo::hasExtension("GL_OES_compressed_ETC1_RGB8_texture");
+	depth = options.depth == 16 ? 16 : 32;
+	memset(&timings, 0, sizeof(timings));
+	streamPool = NULL;
+	cache = options.cacheDirectory.empty() ? NULL : new TextureCache(options.cacheDirectory);
+	streamBudget = 0;
+	residentBytes = 0;
+	streamWindow = count;
+	streamClock = 0;
+	streamFirst = -1;
+	streamLast = -1;
 
-	glGenTextures(count, textures);
+	for (int i = 0; i < count; ++i) {
+		frames[i].page = -1;
+		frames[i].state = FRAME_RESIDENT;
+		frames[i].compressed = false;
+		frames[i].bytes = 0;
+		frames[i].lastUsed = 0;
+	}
 
-	int i = 0;
-	for (std::vector<std::string>::iterator iter = frameFilenames.begin();
-		 iter != frameFilenames.end();
-		 iter++)
-	{
-		printf("Loading texture %d: %s\n", i, (*iter).c_str());
-		loadTexture(*iter, textures[i], wCoords[i], hCoords[i], aspectRatios[i]);
-		i++;
+	if (options.streamingBudget > 0) {
+		initializeStreaming(frameFilenames, options.streamingBudget);
+		return;
+	}
+
+	Clock::Nanoseconds start = Clock::now();
+	DecodePool pool(0, cache);
+
+	if (!(options.atlas && loadAtlas(frameFilenames, pool))) {
+		loadFrames(frameFilenames, pool);
+	}
+
+	printf("Loaded %d frames in %.1f ms on %d decode threads\n",
+			count, Clock::toMilliseconds(Clock::now() - start), pool.threadCount());
+	printf("    decode %.1f ms, convert %.1f ms, upload %.1f ms, waiting for decode %.1f ms\n",
+			Clock::toMilliseconds(timings.decode), Clock::toMilliseconds(timings.convert),
+			Clock::toMilliseconds(timings.upload), Clock::toMilliseconds(pool.waitTime()));
+	if (cache != NULL) {
+		printf("    %d of %d frames from the texture cache\n", timings.cached, count);
 	}
 }
 
 Animation::~Animation()
 {
-	glDeleteTextures(count, textures);
-	delete textures;
-	delete wCoords;
-	delete hCoords;
-	delete aspectRatios;
+	delete streamPool;
+	delete cache;
+	if (!textures.empty()) {
+		GLState::deleteTextures(textures.size(), &textures[0]);
+	}
+	delete[] frames;
 }
 
-void Animation::bindFrame(int n)
+void Animation::stream(int n, float velocity)
 {
-	glBindTexture(GL_TEXTURE_2D, textures[n]);
+	if (streamPool == NULL) {
+		return;
+	}
+
+	relaidOut.clear();
+
+	// Requeue the window around the frame when it moves, nearest first, with
+	// most of it ahead in the direction of motion. Frames already decoding
+	// carry on.
+	int direction = velocity < 0.0f ? -1 : 1;
+	int ahead = (streamWindow - 1) * 3 / 4;
+	int behind = streamWindow - 1 - ahead;
+	int first = direction > 0 ? n - behind : n - ahead;
+	int last  = direction > 0 ? n + ahead : n + behind;
+	if (first < 0)         { first = 0; }
+	if (last > count - 1)  { last = count - 1; }
+
+	if (first != streamFirst || last != streamLast) {
+		streamFirst = first;
+		streamLast = last;
+		++streamClock;
+
+		cancelled.clear();
+		streamPool->cancel(cancelled);
+		for (size_t i = 0; i < cancelled.size(); ++i) {
+			frames[cancelled[i]].state = FRAME_EVICTED;
+		}
+
+		requestFrame(n);
+		for (int d = 1; d <= ahead || d <= behind; ++d) {
+			if (d <= ahead)  { requestFrame(n + direction * d); }
+			if (d <= behind) { requestFrame(n - direction * d); }
+		}
+	}
+
+	// Upload only a few finished frames per call, so streaming never holds up
+	// a frame for long. With nothing resident there's nothing to show, so wait.
+	for (int uploads = 0; uploads < MAX_STREAM_UPLOADS || residentBytes == 0; ++uploads) {
+		DecodedImage *image = residentBytes == 0 ? streamPool->next() : streamPool->poll();
+		if (image == NULL) {
+			break;
+		}
+		bool layoutChanged = uploadStreamedFrame(*image);
+		if (layoutChanged) {
+			relaidOut.push_back(image->id);
+		}
+		streamPool->release(image);
+	}
+}
+
+int Animation::residentFrame(int n)
+{
+	for (int d = 0; d < count; ++d) {
+		if (n - d >= 0 && frames[n - d].state == FRAME_RESIDENT) {
+			return n - d;
+		}
+		if (n + d < count && frames[n + d].state == FRAME_RESIDENT) {
+			return n + d;
+		}
+	}
+	return -1;
+}
+
+void Animation::bindFrame(int n, int unit)
+{
+	GLState::bindTexture(unit, textures[frames[n].page]);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private methods
 
 /*
- * loadTexture
- * Loads texture data from the given file into the given GL texture.
+ * loadFrames
+ * Loads every frame into a texture page of its own.
+ *
+ * The images are decoded on the pool while the ETC1 frames are loaded, and
+ * uploaded in the order they finish decoding.
  *
  * Arguments
- *     filename: Filename of the texture file.
- *     texture:  Handle of the GL texture.
+ *     filenames: Filenames of the texture files.
+ *     pool:      The pool to decode the images on.
  */
-void Animation::loadTexture(std::string filename, unsigned int texture, float &wCoord, float &hCoord, float &aspectRatio)
+void Animation::loadFrames(std::vector<std::string> const& filenames, DecodePool &pool)
 {
-	SDL_Surface *rawSurface = IMG_Load(filename.c_str());
-	SDL_Surface *surface = resizeSurface(rawSurface);
+	std::vector<bool> compressed(count);
+	for (int i = 0; i < count; ++i) {
+		compressed[i] = hasCompressedFrame(filenames[i]);
+		if (!compressed[i]) {
+			pool.submit(i, filenames[i], depth);
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		if (compressed[i]) {
+			printf("Loading texture %d: %s\n", i, filenames[i].c_str());
+			if (!loadCompressedFrame(filenames[i], frames[i])) {
+				pool.submit(i, filenames[i], depth);
+			}
+		}
+	}
+
+	while (DecodedImage *image = pool.next()) {
+		printf("Loading texture %d: %s\n", image->id, image->filename.c_str());
+		loadFrame(*image, frames[image->id]);
+		pool.release(image);
+	}
+}
+
+/*
+ * loadFrame
+ * Loads a decoded frame into a texture page of its own.
+ *
+ * Arguments
+ *     image: The decoded frame.
+ *     frame: Receives the location of the frame.
+ *
+ * Throws
+ *     ImageLoadException if the frame couldn't be decoded.
+ */
+void Animation::loadFrame(DecodedImage const& image, Frame &frame)
+{
+	recordDecode(image);
+
+	frame.page = createPage();
+	frame.left = 0.0f;
+	frame.top  = 0.0f;
+	loadTexture(image, textures[frame.page], frame.right, frame.bottom, frame.aspectRatio);
+}
+
+/*
+ * loadAtlas
+ * Packs all frames into shared texture pages.
+ *
+ * The frame sizes are read from the file headers, so the pages can be laid
+ * out before anything is decoded. The frames are then decoded on the pool,
+ * and each is copied into its page and freed as soon as it is done. Frames
+ * with and without alpha get separate pages, as a page has a single pixel
+ * format. Frames with an ETC1 version are left out of the atlas, as
+ * compressed textures can't be updated in part.
+ *
+ * Arguments
+ *     filenames: Filenames of the texture files.
+ *     pool:      The pool to decode the images on.
+ *
+ * Returns
+ *     false if the frames couldn't be packed, and nothing was loaded.
+ */
+bool Animation::loadAtlas(std::vector<std::string> const& filenames, DecodePool &pool)
+{
+	int maxSize = GLInfo::maxTextureSize();
+
+	// Index 0 packs opaque frames, index 1 frames with alpha
+	TextureAtlas atlases[2] = { TextureAtlas(maxSize, !npot), TextureAtlas(maxSize, !npot) };
+	std::vector<int> atlasOf(count), rectOf(count);
+
+	for (int i = 0; i < count; ++i) {
+		if (hasCompressedFrame(filenames[i])) {
+			atlasOf[i] = -1;
+			continue;
+		}
+
+		ImageInfo info;
+		if (!ImageInfo::read(filenames[i], info)) {
+			printf("Can't read the size of %s; not using an atlas\n", filenames[i].c_str());
+			return false;
+		}
+
+		frames[i].aspectRatio = ((float)info.width) / ((float)info.height);
+		atlasOf[i] = info.hasAlpha ? 1 : 0;
+		rectOf[i] = atlases[atlasOf[i]].add(info.width, info.height);
+	}
+
+	// Lay out and allocate the pages for both atlases
+	int firstPage[2];
+	for (int a = 0; a < 2; ++a) {
+		if (!atlases[a].pack()) {
+			printf("Frames don't fit into a %dx%d atlas\n", maxSize, maxSize);
+			return false;
+		}
+	}
+	for (int a = 0; a < 2; ++a) {
+		int format = a == 1 ? GL_RGBA : GL_RGB;
+		firstPage[a] = textures.size();
+		for (int p = 0; p < atlases[a].pageCount(); ++p) {
+			TextureAtlas::Page const& page = atlases[a].page(p);
+			createPage();
+			glTexImage2D(GL_TEXTURE_2D, 0, format, page.width, page.height, 0, format, pixelType(format, depth), NULL);
+		}
+	}
+
+	printf("Packing %d frames into %d atlas pages\n", count, (int)textures.size());
+
+	// Decode the frames on the pool, while loading the ETC1 frames
+	for (int i = 0; i < count; ++i) {
+		if (atlasOf[i] >= 0) {
+			pool.submit(i, filenames[i], depth);
+		}
+	}
+	for (int i = 0; i < count; ++i) {
+		if (atlasOf[i] < 0) {
+			printf("Loading texture %d: %s\n", i, filenames[i].c_str());
+			if (!loadCompressedFrame(filenames[i], frames[i])) {
+				pool.submit(i, filenames[i], depth);
+			}
+		}
+	}
 
-	int format = surface->format->BytesPerPixel == 4 ? GL_RGBA : GL_RGB;
+	// Copy each frame into its page as it finishes decoding
+	while (DecodedImage *image = pool.next()) {
+		int i = image->id;
+		int a = atlasOf[i];
+		Frame &frame = frames[i];
+		printf("Loading texture %d: %s\n", i, filenames[i].c_str());
 
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
+		if (a < 0 || image->pixels == NULL || image->format != (a == 1 ? GL_RGBA : GL_RGB)
+			|| image->width != atlases[a].rect(rectOf[i]).width
+			|| image->height != atlases[a].rect(rectOf[i]).height)
+		{
+			// An ETC1 frame that failed to load, or doesn't match what the
+			// header said; give it a texture of its own
+			loadFrame(*image, frame);
+			pool.release(image);
+			continue;
+		}
+
+		TextureAtlas::Rect const& rect = atlases[a].rect(rectOf[i]);
+		recordDecode(*image);
+		frame.page = firstPage[a] + rect.page;
+		GLState::bindTexture(0, textures[frame.page]);
+		uploadImage(*image, rect.x, rect.y);
+		pool.release(image);
+
+		// Inset by half a texel, so linear filtering never reaches the neighbouring frames
+		float pageWidth  = atlases[a].page(rect.page).width;
+		float pageHeight = atlases[a].page(rect.page).height;
+		frame.left   = (rect.x + 0.5f) / pageWidth;
+		frame.top    = (rect.y + 0.5f) / pageHeight;
+		frame.right  = (rect.x + rect.width - 0.5f) / pageWidth;
+		frame.bottom = (rect.y + rect.height - 0.5f) / pageHeight;
+	}
+
+	return true;
+}
+
+/*
+ * hasCompressedFrame
+ * Checks whether a frame has an ETC1 version that is at least as new as the
+ * source image.
+ *
+ * Arguments
+ *     filename: Filename of the source texture file.
+ */
+bool Animation::hasCompressedFrame(std::string const& filename)
+{
+	if (!etc1) {
+		return false;
+	}
+
+	struct stat source, compressed;
+	if (stat(FileIO::replaceExtension(filename, ".pkm").c_str(), &compressed) != 0) {
+		return false;
+	}
+	if (stat(filename.c_str(), &source) == 0 && source.st_mtime > compressed.st_mtime) {
+		printf("%s is newer than its ETC1 version; run make compress-textures\n", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+ * loadCompressedFrame
+ * Loads the ETC1 version of a frame into a texture page of its own.
+ *
+ * Arguments
+ *     filename: Filename of the source texture file.
+ *     frame:    Receives the location of the frame.
+ *
+ * Returns
+ *     false if there is no usable ETC1 version, and nothing was loaded.
+ */
+bool Animation::loadCompressedFrame(std::string const& filename, Frame &frame)
+{
+	if (!hasCompressedFrame(filename)) {
+		return false;
+	}
+
+	std::string compressedFilename = FileIO::replaceExtension(filename, ".pkm");
+	std::vector<unsigned char> data;
+	PKMHeader pkm;
+	if (!FileIO::loadBinaryFile(compressedFilename, data) || !checkCompressedData(compressedFilename, data, pkm)) {
+		return false;
+	}
+	loadCompressedData(pkm, data, frame);
+	return true;
+}
+
+/*
+ * checkCompressedData
+ * Checks that the contents of an ETC1 PKM file can be loaded.
+ *
+ * Without NPOT support, only power-of-two sized files can be used.
+ *
+ * Arguments
+ *     filename: Filename of the PKM file, for messages.
+ *     data:     Contents of the PKM file.
+ *     pkm:      Receives the sizes from the header.
+ *
+ * Returns
+ *     false if the data isn't usable.
+ */
+bool Animation::checkCompressedData(std::string const& filename, std::vector<unsigned char> const& data, PKMHeader &pkm)
+{
+	if (data.size() < 16 || !readPKMHeader(&data[0], pkm) || (int)data.size() - 16 < pkm.dataSize) {
+		printf("%s is not a valid ETC1 PKM file\n", filename.c_str());
+		return false;
+	}
+	if (!npot && (pkm.textureWidth != TextureAtlas::nextPowerOfTwo(pkm.textureWidth)
+				  || pkm.textureHeight != TextureAtlas::nextPowerOfTwo(pkm.textureHeight)))
+	{
+		printf("%s is not a power of two in size\n", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+ * loadCompressedData
+ * Loads the contents of an ETC1 PKM file into a texture page of its own.
+ *
+ * Arguments
+ *     pkm:   The header, as checked by checkCompressedData().
+ *     data:  Contents of the PKM file.
+ *     frame: Receives the location of the frame.
+ */
+void Animation::loadCompressedData(PKMHeader const& pkm, std::vector<unsigned char> const& data, Frame &frame)
+{
+	frame.page = createPage();
+	glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_ETC1_RGB8_OES, pkm.textureWidth, pkm.textureHeight, 0, pkm.dataSize, &data[16]);
+	setCompressedLayout(pkm, frame);
+}
+
+/*
+ * readPKMHeader
+ * Parses the header of a PKM file.
+ *
+ * The header is 16 bytes: the magic "PKM 10", the format, and the padded and
+ * original sizes as big-endian 16 bit values. The compressed blocks follow.
+ *
+ * Arguments
+ *     header: The first 16 bytes of the file.
+ *     pkm:    Receives the sizes.
+ *
+ * Returns
+ *     false if the header isn't that of an ETC1 PKM file.
+ */
+bool Animation::readPKMHeader(const unsigned char *header, PKMHeader &pkm)
+{
+	if (memcmp(header, "PKM 10", 6) != 0 || (header[6] << 8 | header[7]) != 0) {
+		return false;
+	}
+
+	pkm.textureWidth  = header[8]  << 8 | header[9];
+	pkm.textureHeight = header[10] << 8 | header[11];
+	pkm.width         = header[12] << 8 | header[13];
+	pkm.height        = header[14] << 8 | header[15];
+	pkm.dataSize = (pkm.textureWidth / 4) * (pkm.textureHeight / 4) * 8;
+
+	return pkm.width > 0 && pkm.height > 0
+		&& pkm.textureWidth >= pkm.width && pkm.textureHeight >= pkm.height
+		&& pkm.textureWidth % 4 == 0 && pkm.textureHeight % 4 == 0;
+}
+
+/*
+ * setCompressedLayout
+ * Sets the location of an ETC1 frame in its page.
+ *
+ * The encoder pads the image to whole blocks by repeating the edge pixels,
+ * so the frame needs no inset.
+ */
+void Animation::setCompressedLayout(PKMHeader const& pkm, Frame &frame)
+{
+	frame.left   = 0.0f;
+	frame.top    = 0.0f;
+	frame.right  = ((float)pkm.width) / pkm.textureWidth;
+	frame.bottom = ((float)pkm.height) / pkm.textureHeight;
+	frame.aspectRatio = ((float)pkm.width) / ((float)pkm.height);
+}
+
+/*
+ * initializeStreaming
+ * Sets up streaming the frames through a fixed budget of texture memory.
+ *
+ * Only the frame headers are read here. The streaming window is as many of
+ * the largest frames as fit into the budget.
+ *
+ * Arguments
+ *     filenames: Filenames of the texture files.
+ *     budget:    Bytes of texture memory the frames may use.
+ *
+ * Throws
+ *     ImageLoadException if the size of a frame can't be read.
+ */
+void Animation::initializeStreaming(std::vector<std::string> const& filenames, long budget)
+{
+	this->filenames = filenames;
+	streamBudget = budget;
+
+	int largest = 1;
+	for (int i = 0; i < count; ++i) {
+		Frame &frame = frames[i];
+		frame.state = FRAME_EVICTED;
+		if (!layoutFrame(filenames[i], frame)) {
+			throw ImageLoadException(filenames[i], "Can't read the image size");
+		}
+		if (frame.bytes > largest) {
+			largest = frame.bytes;
+		}
+	}
+
+	streamWindow = budget / largest;
+	if (streamWindow < 1)     { streamWindow = 1; }
+	if (streamWindow > count) { streamWindow = count; }
+
+	streamPool = new DecodePool(0, cache);
+	printf("Streaming %d frames through %.1f MB of textures, %d at a time\n",
+			count, budget / (1024.0 * 1024.0), streamWindow);
+}
+
+/*
+ * layoutFrame
+ * Works out where a streamed frame will sit in its page, and how much
+ * texture memory it will use, from the file headers.
+ *
+ * Arguments
+ *     filename: Filename of the source texture file.
+ *     frame:    Receives the location and size of the frame.
+ *
+ * Returns
+ *     false if the size of the frame couldn't be read.
+ */
+bool Animation::layoutFrame(std::string const& filename, Frame &frame)
+{
+	frame.compressed = false;
+	if (hasCompressedFrame(filename)) {
+		unsigned char header[16];
+		FILE *file = fopen(FileIO::replaceExtension(filename, ".pkm").c_str(), "rb");
+		PKMHeader pkm;
+		if (file != NULL && fread(header, 1, sizeof(header), file) == sizeof(header)
+			&& readPKMHeader(header, pkm)
+			&& (npot || (pkm.textureWidth == TextureAtlas::nextPowerOfTwo(pkm.textureWidth)
+						 && pkm.textureHeight == TextureAtlas::nextPowerOfTwo(pkm.textureHeight))))
+		{
+			setCompressedLayout(pkm, frame);
+			frame.compressed = true;
+			frame.bytes = pkm.dataSize;
+		}
+		if (file != NULL) {
+			fclose(file);
+		}
+		if (frame.compressed) {
+			return true;
+		}
+	}
+
+	return layoutImage(filename, frame);
+}
+
+/*
+ * layoutImage
+ * Works out where a streamed frame decoded from its source image will sit in
+ * its page, the same way loadTexture() places it.
+ *
+ * Arguments
+ *     filename: Filename of the source texture file.
+ *     frame:    Receives the location and size of the frame.
+ *
+ * Returns
+ *     false if the size of the image couldn't be read.
+ */
+bool Animation::layoutImage(std::string const& filename, Frame &frame)
+{
+	ImageInfo info;
+	if (!ImageInfo::read(filename, info)) {
+		return false;
+	}
+
+	int textureWidth  = npot ? info.width  : TextureAtlas::nextPowerOfTwo(info.width);
+	int textureHeight = npot ? info.height : TextureAtlas::nextPowerOfTwo(info.height);
+	int bytesPerTexel = depth == 16 ? 2 : (info.hasAlpha ? 4 : 3);
+
+	frame.compressed = false;
+	frame.bytes = textureWidth * textureHeight * bytesPerTexel;
+	frame.left   = 0.0f;
+	frame.top    = 0.0f;
+	frame.right  = info.width  == textureWidth  ? 1.0f : (info.width  - 0.5f) / textureWidth;
+	frame.bottom = info.height == textureHeight ? 1.0f : (info.height - 0.5f) / textureHeight;
+	frame.aspectRatio = ((float)info.width) / ((float)info.height);
+	return true;
+}
+
+/*
+ * requestFrame
+ * Marks a frame as part of the streaming window, and queues it for decoding
+ * if it isn't resident.
+ *
+ * Arguments
+ *     n: Index of the frame. Frames outside the animation are ignored.
+ */
+void Animation::requestFrame(int n)
+{
+	if (n < 0 || n >= count) {
+		return;
+	}
+
+	Frame &frame = frames[n];
+	frame.lastUsed = streamClock;
+	if (frame.state != FRAME_EVICTED) {
+		return;
+	}
+
+	frame.state = FRAME_LOADING;
+	if (frame.compressed) {
+		streamPool->submitFile(n, FileIO::replaceExtension(filenames[n], ".pkm"));
+	}
+	else {
+		streamPool->submit(n, filenames[n], depth);
+	}
+}
+
+/*
+ * uploadStreamedFrame
+ * Uploads a frame that finished decoding, evicting older frames to keep
+ * within the budget.
+ *
+ * A frame that left the window while it was decoding may only displace
+ * frames that left it even earlier; if there are none, it is dropped.
+ *
+ * Arguments
+ *     image: The decoded frame.
+ *
+ * Returns
+ *     true if the frame's texture coordinates changed, because a compressed
+ *     frame fell back to its source image.
+ *
+ * Throws
+ *     ImageLoadException if the frame couldn't be decoded.
+ */
+bool Animation::uploadStreamedFrame(DecodedImage const& image)
+{
+	int n = image.id;
+	Frame &frame = frames[n];
+
+	// Find out what will be uploaded before making room for it
+	PKMHeader pkm;
+	if (frame.compressed) {
+		if (image.pixels == NULL || !checkCompressedData(image.filename, image.data, pkm)) {
+			// Fall back to the source image
+			if (!layoutImage(filenames[n], frame)) {
+				throw ImageLoadException(filenames[n], "Can't read the image size");
+			}
+			streamPool->submit(n, filenames[n], depth);
+			return true;
+		}
+		frame.bytes = pkm.dataSize;
+	}
+
+	if (!makeRoom(frame.bytes, frame.lastUsed)) {
+		frame.state = FRAME_EVICTED;
+		return false;
+	}
+
+	if (frame.compressed) {
+		loadCompressedData(pkm, image.data, frame);
+	}
+	else {
+		loadFrame(image, frame);
+	}
+
+	frame.state = FRAME_RESIDENT;
+	residentBytes += frame.bytes;
+	return false;
+}
+
+/*
+ * makeRoom
+ * Evicts the least recently used frames until the given number of bytes
+ * fits into the budget.
+ *
+ * Arguments
+ *     bytes:    Texture memory needed.
+ *     lastUsed: Only frames used before this may be evicted.
+ *
+ * Returns
+ *     false if not enough frames could be evicted. When nothing is resident,
+ *     the bytes always fit, so that there is a frame to show.
+ */
+bool Animation::makeRoom(int bytes, unsigned int lastUsed)
+{
+	while (residentBytes > 0 && residentBytes + bytes > streamBudget) {
+		int victim = -1;
+		for (int i = 0; i < count; ++i) {
+			if (frames[i].state == FRAME_RESIDENT && frames[i].lastUsed < lastUsed
+				&& (victim < 0 || frames[i].lastUsed < frames[victim].lastUsed))
+			{
+				victim = i;
+			}
+		}
+
+		if (victim < 0) {
+			return false;
+		}
+		evictFrame(victim);
+	}
+	return true;
+}
+
+/*
+ * evictFrame
+ * Deletes the texture of a resident frame, and frees its page for reuse.
+ *
+ * Arguments
+ *     n: Index of the frame.
+ */
+void Animation::evictFrame(int n)
+{
+	Frame &frame = frames[n];
+	GLState::deleteTextures(1, &textures[frame.page]);
+	textures[frame.page] = 0;
+	freePages.push_back(frame.page);
+
+	frame.page = -1;
+	frame.state = FRAME_EVICTED;
+	residentBytes -= frame.bytes;
+}
+
+/*
+ * createPage
+ * Creates a new texture page with linear filtering, and binds it to unit 0.
+ *
+ * Returns
+ *     The index of the page.
+ */
+int Animation::createPage()
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+
+	int page;
+	if (freePages.empty()) {
+		page = textures.size();
+		textures.push_back(texture);
+	}
+	else {
+		page = freePages.back();
+		freePages.pop_back();
+		textures[page] = texture;
+	}
+
+	GLState::bindTexture(0, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return page;
+}
+
+/*
+ * loadTexture
+ * Loads a decoded image into the given GL texture.
+ *
+ * The texture is allocated first, and the decoded pixels are copied straight
+ * into it, so no padded copy of the image is made. With non-power-of-two
+ * textures the texture is the size of the image, and the frame covers all of
+ * it; otherwise the frame sits in the corner of a power-of-two texture.
+ *
+ * Arguments
+ *     image:   The decoded image.
+ *     texture: Handle of the GL texture.
+ */
+void Animation::loadTexture(DecodedImage const& image, unsigned int texture, float &wCoord, float &hCoord, float &aspectRatio)
+{
+	int textureWidth  = npot ? image.width  : TextureAtlas::nextPowerOfTwo(image.width);
+	int textureHeight = npot ? image.height : TextureAtlas::nextPowerOfTwo(image.height);
 
-	wCoord = ((float)rawSurface->w) / ((float)surface->w);
-	hCoord = ((float)rawSurface->h) / ((float)surface->h);
-	aspectRatio = ((float)rawSurface->w) / ((float)rawSurface->h);
+	GLState::bindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, image.format, textureWidth, textureHeight, 0, image.format, image.type, NULL);
+	uploadImage(image, 0, 0);
 
-	SDL_FreeSurface(rawSurface);
-	SDL_FreeSurface(surface);
+	// The padding is left undefined, so stop half a texel short of it
+	wCoord = image.width  == textureWidth  ? 1.0f : (image.width  - 0.5f) / textureWidth;
+	hCoord = image.height == textureHeight ? 1.0f : (image.height - 0.5f) / textureHeight;
+	aspectRatio = ((float)image.width) / ((float)image.height);
 }
 
 /*
- * resizeSurface
- * Generates a new SDL_Surface with the pixel data of a source surface, resized
- * (not scaled) to the smallest containing power of 2 in both dimensions.
+ * uploadImage
+ * Copies the pixels of a decoded image into a region of the bound texture.
  *
- * The caller is responsible for calling SDL_FreeSurface() on the result.
+ * The rows are passed to GL in place. If the image pitch can't be expressed
+ * as an unpack alignment, the rows are uploaded one at a time.
  *
  * Arguments
- *     surface: The source SDL_Surface
- * Returns
- *     A newly allocated resized SDL_Surface
+ *     image: The decoded image.
+ *     x, y:  Position of the region in the texture.
  */
-SDL_Surface *Animation::resizeSurface(SDL_Surface *surface)
+void Animation::uploadImage(DecodedImage const& image, int x, int y)
 {
-	// Calculate smallest power-of-2 dimensions that contain the surface
-	int newWidth = 1, newHeight = 1;
-	while (newWidth < surface->w) {
-		newWidth <<= 1;
+	Clock::Nanoseconds start = Clock::now();
+	int rowBytes = image.width * image.bytesPerPixel;
+
+	// Find the alignment that rounds a row of pixels up to the pitch
+	for (int alignment = 8; alignment >= 1; alignment >>= 1) {
+		if (image.pitch == ((rowBytes + alignment - 1) & ~(alignment - 1))) {
+			GLState::unpackAlignment(alignment);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, image.width, image.height, image.format, image.type, image.pixels);
+			timings.upload += Clock::now() - start;
+			return;
+		}
 	}
-	while (newHeight < surface->h) {
-		newHeight <<= 1;
+
+	// OpenGL ES has no GL_UNPACK_ROW_LENGTH, so upload row by row
+	GLState::unpackAlignment(1);
+	const unsigned char *row = (const unsigned char *)image.pixels;
+	for (int i = 0; i < image.height; ++i, row += image.pitch) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y + i, image.width, 1, image.format, image.type, row);
 	}
+	timings.upload += Clock::now() - start;
+}
 
-	// Blit to the new surface
-	SDL_PixelFormat *format = surface->format;
-	SDL_Surface *newSurface = SDL_CreateRGBSurface(surface->flags, newWidth, newHeight, format->BitsPerPixel,
-								format->Rmask, format->Gmask, format->Bmask, format->Amask);
-	SDL_BlitSurface(surface, NULL, newSurface, NULL);
+/*
+ * recordDecode
+ * Adds the decode timings of an image to the totals, and checks that the
+ * image was decoded.
+ *
+ * Arguments
+ *     image: The decoded image.
+ *
+ * Throws
+ *     ImageLoadException if the image couldn't be decoded.
+ */
+void Animation::recordDecode(DecodedImage const& image)
+{
+	if (image.pixels == NULL) {
+		throw ImageLoadException(image.filename, image.error);
+	}
+	timings.decode += image.decodeTime;
+	if (image.cached) {
+		++timings.cached;
+	}
+	timings.convert += image.convertTime;
+}
 
-	return newSurface;
+/*
+ * pixelType
+ * Returns the GL pixel type for a texture format at the given depth.
+ *
+ * Arguments
+ *     format: GL_RGB or GL_RGBA.
+ *     depth:  Bits per texel, 32 or 16.
+ */
+int Animation::pixelType(int format, int depth)
+{
+	if (depth != 16) {
+		return GL_UNSIGNED_BYTE;
+	}
+	return format == GL_RGBA ? GL_UNSIGNED_SHORT_4_4_4_4 : GL_UNSIGNED_SHORT_5_6_5;
 }
@@ -8,16 +8,45 @@
 #include "SDL.h"
 #include "SDL_image.h"
 
+#include "Clock.h"
+#include "DecodePool.h"
+#include "GLState.h"
+
 /*
  * Animation
  * Represents a series of GL textures for an animation.
+ *
+ * Each frame lives in a rectangle of a texture page. Without an atlas every
+ * frame has a page of its own; with an atlas, frames share as few pages as
+ * the maximum texture size allows.
+ *
+ * A frame with an up-to-date ETC1 version next to it ("frame.pkm" for
+ * "frame.jpg", written by tools/etc1pack) is loaded compressed instead, when
+ * the driver supports ETC1. Compressed frames always get a page of their own.
+ *
+ * With a streaming budget, only the frames around the one being shown are
+ * kept in texture memory, and stream() loads and evicts frames as the
+ * animation moves.
  */
 class Animation {
 	public:
+		// Options for loading an animation
+		struct Options {
+			bool atlas;                  // Pack the frames into shared textures
+			bool npot;                   // Allow non-power-of-two textures, if the driver supports them
+			bool compressed;             // Use ETC1 versions of the frames, where available
+			int depth;                   // Bits per texel of uncompressed frames: 32, or 16 for dithered RGB565/RGBA4444
+			long streamingBudget;        // Bytes of texture memory to stream the frames through, or 0 to load them all
+			std::string cacheDirectory;  // Directory to cache decoded frames in, or empty for no cache
+
+			Options() : atlas(false), npot(true), compressed(true), depth(32), streamingBudget(0) {}
+		};
+
 		// Constructor
 		// Arguments
 		//		frameFilenames: A list of filenames for textures corresponding to each frame of animation.
-		Animation(std::vector <std::string> frameFilenames);
+		//		options:        Options for loading the textures.
+		Animation(std::vector <std::string> frameFilenames, Options const& options = Options());
 
 		// Destructor
 		~Animation();
@@ -25,27 +54,127 @@ class Animation {
 		// Returns the number of frames in the animation.
 		int frameCount() { return count; }
 
+		// Returns the number of textures holding the frames.
+		int pageCount() { return textures.size(); }
+
+		// Streams frames in and out of texture memory around the frame being shown.
+		// Does nothing unless the animation was loaded with a streaming budget.
+		// Arguments
+		//		n:        Index of the frame being shown
+		//		velocity: Direction the animation is moving in; frames ahead are loaded first
+		void stream(int n, float velocity);
+
+		// Returns the frames whose texture coordinates changed in the last call
+		// to stream(), e.g. because a compressed frame was replaced with its
+		// source image. Their ScreenQuad coordinates need updating.
+		std::vector<int> const& relaidOutFrames() { return relaidOut; }
+
+		// Returns the frame nearest to n whose texture is loaded, or -1 if no
+		// frame is loaded yet.
+		int residentFrame(int n);
+
 		// Binds the GL texture for the specified frame of animation.
-		void bindFrame(int n);
+		// Arguments
+		//		n:    Index of the frame
+		//		unit: Index of the texture unit to bind to
+		void bindFrame(int n, int unit = 0);
+
+		// Returns the texture coordinate for the left of the given frame.
+		float frameXCoord(int n) { return frames[n].left; }
+
+		// Returns the texture coordinate for the top of the given frame.
+		float frameYCoord(int n) { return frames[n].top; }
 
 		// Returns the texture coordinate for the right of the given frame.
-		float frameWCoord(int n) { return wCoords[n]; }
+		float frameWCoord(int n) { return frames[n].right; }
 
 		// Returns the texture coordinate for the bottom of the given frame.
-		float frameHCoord(int n) { return hCoords[n]; }
+		float frameHCoord(int n) { return frames[n].bottom; }
 
 		// Returns the aspect ratio for the given frame.
-		float aspectRatio(int n) { return aspectRatios[n]; }
+		float aspectRatio(int n) { return frames[n].aspectRatio; }
 
 	private:
+		enum {
+			MAX_STREAM_UPLOADS = 2  // Frames uploaded per call to stream()
+		};
+
+		enum FrameState {
+			FRAME_RESIDENT,  // In a texture page
+			FRAME_LOADING,   // Queued or decoding
+			FRAME_EVICTED    // Not in texture memory
+		};
+
+		// Location of a frame in its texture page
+		struct Frame {
+			int page;  // -1 while not resident
+			float left, top, right, bottom;
+			float aspectRatio;
+
+			int state;              // FrameState
+			bool compressed;        // Streamed from its ETC1 version
+			int bytes;              // Texture memory used by the frame
+			unsigned int lastUsed;  // Value of streamClock when last in the streaming window
+		};
+
+		// Sizes from the header of a PKM file
+		struct PKMHeader {
+			int width, height;
+			int textureWidth, textureHeight;
+			int dataSize;
+		};
+
 		int count;
-		unsigned int *textures;
-		float *wCoords;
-		float *hCoords;
-		float *aspectRatios;
+		Frame *frames;
+		std::vector<unsigned int> textures;  // One per page
+		std::vector<int> freePages;          // Pages whose textures were deleted
+		bool npot;                           // Whether textures are sized without padding
+		bool etc1;                           // Whether ETC1 frames may be used
+		int depth;                           // Bits per texel of uncompressed frames
+
+		// Total time spent in each stage of loading
+		struct Timings {
+			Clock::Nanoseconds decode;   // Decoding images, summed over the decode threads
+			Clock::Nanoseconds convert;  // Converting to 16 bits, summed over the decode threads
+			Clock::Nanoseconds upload;   // Uploading to textures
+			int cached;                  // Frames loaded from the texture cache
+		} timings;
+		TextureCache *cache;                 // NULL without a cache directory
+
+		// Streaming
+		std::vector<std::string> filenames;  // Kept for reloading evicted frames
+		DecodePool *streamPool;              // NULL unless streaming
+		long streamBudget;                   // Bytes of texture memory the frames may use
+		long residentBytes;                  // Bytes of texture memory the frames use
+		int streamWindow;                    // Frames kept around the one being shown
+		unsigned int streamClock;            // Advances whenever the window moves
+		int streamFirst, streamLast;         // Frames at the ends of the window, or -1 before the first call
+		std::vector<int> cancelled;          // Reused by stream(), so it doesn't allocate
+		std::vector<int> relaidOut;          // Frames laid out again by the last call to stream()
+
+		void loadFrames(std::vector<std::string> const& filenames, DecodePool &pool);
+		void loadFrame(DecodedImage const& image, Frame &frame);
+		bool loadAtlas(std::vector<std::string> const& filenames, DecodePool &pool);
+		bool loadCompressedFrame(std::string const& filename, Frame &frame);
+		bool checkCompressedData(std::string const& filename, std::vector<unsigned char> const& data, PKMHeader &pkm);
+		void loadCompressedData(PKMHeader const& pkm, std::vector<unsigned char> const& data, Frame &frame);
+		bool hasCompressedFrame(std::string const& filename);
+		int createPage();
+
+		void initializeStreaming(std::vector<std::string> const& filenames, long budget);
+		bool layoutFrame(std::string const& filename, Frame &frame);
+		bool layoutImage(std::string const& filename, Frame &frame);
+		void requestFrame(int n);
+		bool uploadStreamedFrame(DecodedImage const& image);
+		bool makeRoom(int bytes, unsigned int lastUsed);
+		void evictFrame(int n);
 
-		static void loadTexture(std::string filename, unsigned int texture, float &wCoord, float &hCoord, float &aspectRatio);
-		static SDL_Surface *resizeSurface(SDL_Surface *surface);
+		void loadTexture(DecodedImage const& image, unsigned int texture, float &wCoord, float &hCoord, float &aspectRatio);
+		void uploadImage(DecodedImage const& image, int x, int y);
+		void recordDecode(DecodedImage const& image);
+		static int pixelType(int format, int depth);
+		static bool readPKMHeader(const unsigned char *header, PKMHeader &pkm);
+		static void setCompressedLayout(PKMHeader const& pkm, Frame &frame);
 };
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <cerrno>
+#include <ctime>
+
+/*
+ * Clock
+ * High-resolution monotonic time source, with timestamps in nanoseconds.
+ */
+class Clock {
+	public:
+		typedef long long Nanoseconds;
+
+		// Returns the current monotonic time.
+		static Nanoseconds now()
+		{
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (Nanoseconds)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+		}
+
+		// Sleeps until the monotonic clock reaches the given time.
+		// Returns immediately if the time has already passed.
+		// Arguments
+		//		deadline: Monotonic time to wake up at.
+		static void sleepUntil(Nanoseconds deadline)
+		{
+			timespec ts;
+			ts.tv_sec  = deadline / 1000000000LL;
+			ts.tv_nsec = deadline % 1000000000LL;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+				// Interrupted by a signal; keep sleeping until the deadline
+			}
+		}
+
+		// Conversions
+		static Nanoseconds fromMilliseconds(double ms) { return (Nanoseconds)(ms * 1000000.0); }
+		static double toMilliseconds(Nanoseconds ns) { return ns / 1000000.0; }
+		static double toSeconds(Nanoseconds ns) { return ns / 1000000000.0; }
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "DecodePool.h"
+
+#include <unistd.h>
+
+#include <GLES2/gl2.h>
+
+#include "FileIO.h"
+#include "PixelConverter.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+DecodePool::DecodePool(int threadCount, TextureCache *cache)
+	: cache(cache), outstanding(0), running(true), waited(0)
+{
+	if (threadCount <= 0) {
+		threadCount = coreCount();
+	}
+	maxResults = threadCount * 2;
+
+	mutex = SDL_CreateMutex();
+	jobQueued = SDL_CreateCond();
+	resultQueued = SDL_CreateCond();
+	resultTaken = SDL_CreateCond();
+
+	for (int i = 0; i < threadCount; ++i) {
+		threads.push_back(SDL_CreateThread(threadMain, this));
+	}
+}
+
+DecodePool::~DecodePool()
+{
+	SDL_LockMutex(mutex);
+	running = false;
+	SDL_CondBroadcast(jobQueued);
+	SDL_CondBroadcast(resultTaken);
+	SDL_UnlockMutex(mutex);
+
+	for (size_t i = 0; i < threads.size(); ++i) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	while (!results.empty()) {
+		release(results.front());
+		results.pop_front();
+	}
+
+	SDL_DestroyCond(resultTaken);
+	SDL_DestroyCond(resultQueued);
+	SDL_DestroyCond(jobQueued);
+	SDL_DestroyMutex(mutex);
+}
+
+void DecodePool::submit(int id, std::string const& filename, int depth)
+{
+	Job job;
+	job.id = id;
+	job.filename = filename;
+	job.depth = depth;
+
+	SDL_LockMutex(mutex);
+	jobs.push_back(job);
+	++outstanding;
+	SDL_CondSignal(jobQueued);
+	SDL_UnlockMutex(mutex);
+}
+
+void DecodePool::submitFile(int id, std::string const& filename)
+{
+	submit(id, filename, 0);
+}
+
+void DecodePool::cancel(std::vector<int> &ids)
+{
+	SDL_LockMutex(mutex);
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		ids.push_back(jobs[i].id);
+	}
+	outstanding -= jobs.size();
+	jobs.clear();
+	SDL_UnlockMutex(mutex);
+}
+
+DecodedImage *DecodePool::next()
+{
+	SDL_LockMutex(mutex);
+	if (outstanding == 0) {
+		SDL_UnlockMutex(mutex);
+		return NULL;
+	}
+
+	if (results.empty()) {
+		Clock::Nanoseconds start = Clock::now();
+		while (results.empty()) {
+			SDL_CondWait(resultQueued, mutex);
+		}
+		waited += Clock::now() - start;
+	}
+
+	DecodedImage *image = results.front();
+	results.pop_front();
+	--outstanding;
+	SDL_CondSignal(resultTaken);
+	SDL_UnlockMutex(mutex);
+	return image;
+}
+
+DecodedImage *DecodePool::poll()
+{
+	SDL_LockMutex(mutex);
+	if (results.empty()) {
+		SDL_UnlockMutex(mutex);
+		return NULL;
+	}
+
+	DecodedImage *image = results.front();
+	results.pop_front();
+	--outstanding;
+	SDL_CondSignal(resultTaken);
+	SDL_UnlockMutex(mutex);
+	return image;
+}
+
+void DecodePool::release(DecodedImage *image)
+{
+	TextureCache::release(*image);
+	if (image->surface != NULL) {
+		SDL_FreeSurface(image->surface);
+	}
+	delete image;
+}
+
+int DecodePool::coreCount()
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (int)cores : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+int DecodePool::threadMain(void *pool)
+{
+	((DecodePool *)pool)->run();
+	return 0;
+}
+
+/*
+ * run
+ * Worker thread loop. Decodes queued images until the pool is destroyed,
+ * pausing while too many decoded images are waiting to be picked up.
+ */
+void DecodePool::run()
+{
+	SDL_LockMutex(mutex);
+	while (running) {
+		if (jobs.empty() || (int)results.size() >= maxResults) {
+			SDL_CondWait(jobs.empty() ? jobQueued : resultTaken, mutex);
+			continue;
+		}
+
+		Job job = jobs.front();
+		jobs.pop_front();
+		SDL_UnlockMutex(mutex);
+
+		DecodedImage *image = decode(job);
+
+		SDL_LockMutex(mutex);
+		results.push_back(image);
+		SDL_CondSignal(resultQueued);
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+/*
+ * decode
+ * Decodes an image file, and converts it to 16 bits if requested. Files
+ * queued with submitFile() are only read. Decoded images are taken from and
+ * added to the cache, if there is one.
+ *
+ * Arguments
+ *     job: The image to decode.
+ *
+ * Returns
+ *     The decoded image. Its pixels are NULL if the file couldn't be decoded.
+ */
+DecodedImage *DecodePool::decode(Job const& job)
+{
+	DecodedImage *image = new DecodedImage();
+	image->id = job.id;
+	image->filename = job.filename;
+	image->pixels = NULL;
+	image->convertTime = 0;
+	image->cached = false;
+	image->surface = NULL;
+	image->mapping = NULL;
+	image->mappingSize = 0;
+
+	Clock::Nanoseconds start = Clock::now();
+	if (job.depth == 0) {
+		bool loaded = FileIO::loadBinaryFile(job.filename, image->data) && !image->data.empty();
+		image->decodeTime = Clock::now() - start;
+		image->width = image->height = 0;
+		image->format = 0;
+		image->type = 0;
+		image->bytesPerPixel = 1;
+		image->pitch = image->data.size();
+		image->pixels = loaded ? &image->data[0] : NULL;
+		if (!loaded) {
+			image->error = "Can't read the file";
+		}
+		return image;
+	}
+
+	if (cache != NULL && cache->load(job.filename, job.depth, *image)) {
+		image->cached = true;
+		image->decodeTime = Clock::now() - start;
+		return image;
+	}
+
+	image->surface = IMG_Load(job.filename.c_str());
+	image->decodeTime = Clock::now() - start;
+
+	SDL_Surface *surface = image->surface;
+	if (surface == NULL) {
+		// SDL keeps an error message per thread, so it has to be read here
+		image->error = IMG_GetError();
+		image->width = image->height = 0;
+		image->format = GL_RGB;
+		image->type = GL_UNSIGNED_BYTE;
+		image->bytesPerPixel = image->pitch = 0;
+		return image;
+	}
+
+	image->width = surface->w;
+	image->height = surface->h;
+	image->format = surface->format->BytesPerPixel == 4 ? GL_RGBA : GL_RGB;
+	image->type = GL_UNSIGNED_BYTE;
+	image->bytesPerPixel = surface->format->BytesPerPixel;
+	image->pitch = surface->pitch;
+	image->pixels = surface->pixels;
+
+	if (job.depth == 16) {
+		start = Clock::now();
+		image->texels.resize(surface->w * surface->h);
+		if (image->format == GL_RGBA) {
+			PixelConverter::toRGBA4444((const unsigned char *)surface->pixels, surface->pitch, &image->texels[0], surface->w, surface->h);
+			image->type = GL_UNSIGNED_SHORT_4_4_4_4;
+		}
+		else {
+			PixelConverter::toRGB565((const unsigned char *)surface->pixels, surface->pitch, &image->texels[0], surface->w, surface->h);
+			image->type = GL_UNSIGNED_SHORT_5_6_5;
+		}
+		image->convertTime = Clock::now() - start;
+
+		// The 8 bit pixels aren't needed any more
+		SDL_FreeSurface(surface);
+		image->surface = NULL;
+		image->bytesPerPixel = 2;
+		image->pitch = image->width * 2;
+		image->pixels = &image->texels[0];
+	}
+
+	if (cache != NULL) {
+		start = Clock::now();
+		cache->store(job.filename, job.depth, *image);
+		image->decodeTime += Clock::now() - start;
+	}
+	return image;
+}
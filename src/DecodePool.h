@@ -0,0 +1,132 @@
+#ifndef __DECODEPOOL_H__
+#define __DECODEPOOL_H__
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_image.h"
+
+#include "Clock.h"
+#include "TextureCache.h"
+
+/*
+ * DecodedImage
+ * An image decoded by the DecodePool, ready to be uploaded to a texture.
+ */
+struct DecodedImage {
+	int id;                    // Identifier passed to DecodePool::submit()
+	std::string filename;
+
+	int width, height;
+	int format;                // GL_RGB or GL_RGBA
+	int type;                  // GL_UNSIGNED_BYTE, or a 16 bit packed type
+	int bytesPerPixel;         // Bytes per pixel of the data
+	int pitch;                 // Bytes between the starts of rows
+	const void *pixels;        // NULL if the image couldn't be decoded
+	std::string error;         // Why it couldn't, from the worker thread that tried
+
+	Clock::Nanoseconds decodeTime;   // Time spent decoding the file or mapping it from the cache, and caching it
+	Clock::Nanoseconds convertTime;  // Time spent converting to 16 bits
+	bool cached;                     // Whether the pixels came from the texture cache
+
+	SDL_Surface *surface;                // Decoded image
+	std::vector<unsigned short> texels;  // Converted image, when converting to 16 bits
+	std::vector<unsigned char> data;     // Contents of the file, when read without decoding
+	void *mapping;                       // Mapped cache entry holding the pixels
+	size_t mappingSize;
+};
+
+/*
+ * DecodePool
+ * Decodes images on a pool of worker threads.
+ *
+ * Images are handed back in the order they finish, on the thread that
+ * submitted them, which does the GL upload. Workers stop decoding once a few
+ * finished images per thread are waiting to be picked up, so memory use stays
+ * bounded however far the uploads fall behind.
+ *
+ * With a TextureCache, images are mapped from the cache when possible, and
+ * cached after decoding otherwise.
+ */
+class DecodePool {
+	public:
+		// Constructor
+		// Arguments
+		//		threadCount: Number of worker threads, or 0 for one per processor core.
+		//		cache:       Cache of decoded images, or NULL.
+		DecodePool(int threadCount = 0, TextureCache *cache = NULL);
+
+		// Destructor
+		// Waits for the workers to finish the images they're decoding.
+		~DecodePool();
+
+		// Queues an image for decoding.
+		// Arguments
+		//		id:       Identifier returned with the decoded image.
+		//		filename: Filename of the image file.
+		//		depth:    Bits per texel to convert to: 32, or 16 for dithered RGB565/RGBA4444.
+		void submit(int id, std::string const& filename, int depth);
+
+		// Queues a file to be read into memory as it is, e.g. a compressed texture.
+		// The contents are returned in DecodedImage::data.
+		// Arguments
+		//		id:       Identifier returned with the file contents.
+		//		filename: Filename of the file.
+		void submitFile(int id, std::string const& filename);
+
+		// Removes the queued images that no worker has started on yet.
+		// Arguments
+		//		ids: Receives the identifiers of the removed images.
+		void cancel(std::vector<int> &ids);
+
+		// Returns the next decoded image, waiting for one if necessary.
+		// Returns
+		//		NULL once every submitted image has been returned.
+		DecodedImage *next();
+
+		// Returns the next decoded image, if one is ready.
+		// Returns
+		//		NULL if no image has finished decoding.
+		DecodedImage *poll();
+
+		// Frees a decoded image returned by next().
+		void release(DecodedImage *image);
+
+		// Returns the number of worker threads.
+		int threadCount() { return threads.size(); }
+
+		// Returns the total time next() has spent waiting for the workers.
+		Clock::Nanoseconds waitTime() { return waited; }
+
+		// Returns the number of processor cores online.
+		static int coreCount();
+
+	private:
+		struct Job {
+			int id;
+			std::string filename;
+			int depth;      // 0 to read the file without decoding it
+		};
+
+		TextureCache *cache;
+		std::vector<SDL_Thread *> threads;
+		std::deque<Job> jobs;
+		std::deque<DecodedImage *> results;
+		int outstanding;   // Images submitted and not yet returned by next()
+		int maxResults;    // Decoded images allowed to wait for next()
+		bool running;
+		Clock::Nanoseconds waited;
+
+		SDL_mutex *mutex;
+		SDL_cond *jobQueued;
+		SDL_cond *resultQueued;
+		SDL_cond *resultTaken;
+
+		static int threadMain(void *pool);
+		void run();
+		DecodedImage *decode(Job const& job);
+};
+
+#endif
@@ -44,4 +44,14 @@ class JsonParseException : public std::runtime_error {
 		JsonParseException(std::string const& message) : std::runtime_error("JSON parsing error\n" + message) {}
 };
 
+/*
+ * ImageLoadException
+ * Thrown when an image file can't be loaded.
+ */
+class ImageLoadException : public std::runtime_error {
+	public:
+		ImageLoadException() : std::runtime_error("Image loading error") {}
+		ImageLoadException(std::string const& filename, std::string const& message) : std::runtime_error("Image loading error on file \"" + filename + "\"\n" + message) {}
+};
+
 #endif
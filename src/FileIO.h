@@ -1,13 +1,17 @@
 #ifndef __FILEIO_H__
 #define __FILEIO_H__
 
+#include <cerrno>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <sys/stat.h>
 
 #include "json/reader.h"
 #include "json/value.h"
 
+#include "Exceptions.h"
+
 /*
  * FileIO
  * Utility methods for handling file input/output.
@@ -29,6 +33,68 @@ class FileIO {
 			return text;
 		}
 
+		// Loads a binary file into a byte vector.
+		// Arguments
+		//		filename: Filename of the file to load.
+		//		data:     Receives the contents of the file.
+		// Returns
+		//		false if the file couldn't be read.
+		static bool loadBinaryFile(std::string const& filename, std::vector<unsigned char> &data)
+		{
+			std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+			if (!file) {
+				return false;
+			}
+
+			file.seekg(0, std::ios::end);
+			std::streamoff size = file.tellg();
+			file.seekg(0, std::ios::beg);
+			if (size < 0) {
+				return false;
+			}
+
+			data.resize(size);
+			if (size > 0) {
+				file.read((char *)&data[0], size);
+			}
+			return !file.fail();
+		}
+
+		// Returns a filename with its extension replaced.
+		// Arguments
+		//		filename:  The original filename.
+		//		extension: The new extension, including the dot.
+		static std::string replaceExtension(std::string const& filename, std::string const& extension)
+		{
+			size_t dot = filename.find_last_of('.');
+			size_t slash = filename.find_last_of('/');
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+				return filename + extension;
+			}
+			return filename.substr(0, dot) + extension;
+		}
+
+		// Creates a directory and any missing parents.
+		// Arguments
+		//		path: Path of the directory.
+		// Returns
+		//		false if the directory doesn't exist and couldn't be created.
+		static bool createDirectories(std::string const& path)
+		{
+			for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+				std::string parent = path.substr(0, slash);
+				if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST) {
+					return false;
+				}
+				if (slash == std::string::npos) {
+					break;
+				}
+			}
+
+			struct stat info;
+			return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+		}
+
 		// Loads a text file into a vector of strings.
 		// Arguments
 		//		filename: Filename of the file to load.
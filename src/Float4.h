@@ -0,0 +1,162 @@
+#ifndef __FLOAT4_H__
+#define __FLOAT4_H__
+
+/*
+ * Float4
+ * Four floats operated on together: one SSE or NEON register where the
+ * compiler targets either, and four plain floats otherwise. The operations
+ * are written once in terms of these functions, and every backend inlines
+ * them away.
+ *
+ * Loads and stores are unaligned. It costs nothing on aligned data, and
+ * objects inside heap allocations aren't guaranteed 16-byte alignment by
+ * C++98 operator new.
+ */
+
+#if defined(__SSE__)
+
+#include <xmmintrin.h>
+
+typedef __m128 Float4;
+
+static inline Float4 load4(const float *p)                     { return _mm_loadu_ps(p); }
+static inline void store4(float *p, Float4 f)                  { _mm_storeu_ps(p, f); }
+static inline Float4 splat4(float f)                           { return _mm_set1_ps(f); }
+static inline Float4 make4(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+static inline Float4 add4(Float4 a, Float4 b)                  { return _mm_add_ps(a, b); }
+static inline Float4 mul4(Float4 a, Float4 b)                  { return _mm_mul_ps(a, b); }
+static inline Float4 sub4(Float4 a, Float4 b)                  { return _mm_sub_ps(a, b); }
+static inline Float4 madd4(Float4 a, Float4 b, Float4 c)       { return _mm_add_ps(a, _mm_mul_ps(b, c)); }  // a + b * c
+static inline Float4 splatW4(Float4 f)                         { return _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+static inline void store3(float *p, Float4 f)
+{
+	_mm_storel_pi((__m64 *)p, f);
+	_mm_store_ss(p + 2, _mm_movehl_ps(f, f));
+}
+
+// Sum of the four lanes
+static inline float sum4(Float4 f)
+{
+	Float4 pairs = _mm_add_ps(f, _mm_movehl_ps(f, f));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+// 1 / sqrt(f), from the 12-bit estimate refined by one Newton-Raphson step
+static inline float rsqrt(float f)
+{
+	Float4 x = _mm_set_ss(f);
+	Float4 y = _mm_rsqrt_ss(x);
+	Float4 yy = _mm_mul_ss(y, y);
+	y = _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), y), _mm_sub_ss(_mm_set_ss(3.0f), _mm_mul_ss(x, yy)));
+	return _mm_cvtss_f32(y);
+}
+
+#elif defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+typedef float32x4_t Float4;
+
+static inline Float4 load4(const float *p)                     { return vld1q_f32(p); }
+static inline void store4(float *p, Float4 f)                  { vst1q_f32(p, f); }
+static inline Float4 splat4(float f)                           { return vdupq_n_f32(f); }
+static inline Float4 add4(Float4 a, Float4 b)                  { return vaddq_f32(a, b); }
+static inline Float4 mul4(Float4 a, Float4 b)                  { return vmulq_f32(a, b); }
+static inline Float4 sub4(Float4 a, Float4 b)                  { return vsubq_f32(a, b); }
+static inline Float4 madd4(Float4 a, Float4 b, Float4 c)       { return vmlaq_f32(a, b, c); }  // a + b * c
+static inline Float4 splatW4(Float4 f)                         { return vdupq_lane_f32(vget_high_f32(f), 1); }
+
+static inline Float4 make4(float x, float y, float z, float w)
+{
+	const float lanes[4] = { x, y, z, w };
+	return vld1q_f32(lanes);
+}
+
+static inline void store3(float *p, Float4 f)
+{
+	vst1_f32(p, vget_low_f32(f));
+	vst1q_lane_f32(p + 2, f, 2);
+}
+
+// Sum of the four lanes
+static inline float sum4(Float4 f)
+{
+	float32x2_t pairs = vadd_f32(vget_low_f32(f), vget_high_f32(f));
+	return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+}
+
+// 1 / sqrt(f), from the 8-bit estimate refined by two Newton-Raphson steps
+static inline float rsqrt(float f)
+{
+	float32x2_t x = vdup_n_f32(f);
+	float32x2_t y = vrsqrte_f32(x);
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(x, y), y));
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(x, y), y));
+	return vget_lane_f32(y, 0);
+}
+
+#else
+
+// Named members rather than an array, so the compiler keeps them in registers
+struct Float4 {
+	float x, y, z, w;
+};
+
+static inline Float4 make4(float x, float y, float z, float w)
+{
+	Float4 f = { x, y, z, w };
+	return f;
+}
+
+static inline Float4 load4(const float *p)                     { return make4(p[0], p[1], p[2], p[3]); }
+static inline Float4 splat4(float f)                           { return make4(f, f, f, f); }
+static inline Float4 add4(Float4 a, Float4 b)                  { return make4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+static inline Float4 mul4(Float4 a, Float4 b)                  { return make4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+static inline Float4 sub4(Float4 a, Float4 b)                  { return make4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+static inline Float4 madd4(Float4 a, Float4 b, Float4 c)       { return add4(a, mul4(b, c)); }  // a + b * c
+static inline Float4 splatW4(Float4 f)                         { return splat4(f.w); }
+
+static inline void store4(float *p, Float4 f)
+{
+	p[0] = f.x;
+	p[1] = f.y;
+	p[2] = f.z;
+	p[3] = f.w;
+}
+
+static inline void store3(float *p, Float4 f)
+{
+	p[0] = f.x;
+	p[1] = f.y;
+	p[2] = f.z;
+}
+
+// Sum of the four lanes
+static inline float sum4(Float4 f)
+{
+	return (f.x + f.y) + (f.z + f.w);
+}
+
+// 1 / sqrt(f), from the bit pattern estimate refined by two Newton-Raphson
+// steps. VFP's square root and divide take about 19 cycles each, and don't
+// pipeline; these multiplies do.
+static inline float rsqrt(float f)
+{
+	union {
+		float f;
+		unsigned int i;
+	} bits;
+	bits.f = f;
+	bits.i = 0x5f3759df - (bits.i >> 1);
+
+	float y = bits.f;
+	float half = 0.5f * f;
+	y = y * (1.5f - half * y * y);
+	y = y * (1.5f - half * y * y);
+	return y;
+}
+
+#endif
+
+#endif
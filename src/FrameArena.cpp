@@ -0,0 +1,36 @@
+#include "FrameArena.h"
+
+#include <cstdio>
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+FrameArena::FrameArena(size_t capacity)
+	: size(capacity), offset(0), peak(0)
+{
+	buffer = new char[capacity];
+}
+
+FrameArena::~FrameArena()
+{
+	delete[] buffer;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	// Align the address rather than the offset, as the buffer itself is only
+	// as aligned as the heap makes it
+	size_t address = (size_t)(buffer + offset);
+	size_t start = offset + (((address + alignment - 1) & ~(alignment - 1)) - address);
+	if (start + bytes > size) {
+		printf("Frame arena exhausted: %u of %u bytes in use, %u more requested\n",
+				(unsigned int)offset, (unsigned int)size, (unsigned int)bytes);
+		throw std::bad_alloc();
+	}
+
+	offset = start + bytes;
+	if (offset > peak) {
+		peak = offset;
+	}
+	return buffer + start;
+}
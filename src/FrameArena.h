@@ -0,0 +1,65 @@
+#ifndef __FRAMEARENA_H__
+#define __FRAMEARENA_H__
+
+#include <cstddef>
+#include <new>
+
+/*
+ * FrameArena
+ * Linear allocator for objects that only live for one frame.
+ *
+ * Allocation bumps an offset into a buffer that is allocated once, and
+ * reset() releases everything at once at the start of the next frame.
+ * Destructors are never run, so only objects that need no destruction
+ * belong in the arena.
+ */
+class FrameArena {
+	public:
+		// Constructor
+		// Arguments
+		//		capacity: Size of the buffer in bytes.
+		FrameArena(size_t capacity);
+
+		// Destructor
+		~FrameArena();
+
+		// Returns uninitialized memory that stays valid until the next reset().
+		// Arguments
+		//		bytes:     Number of bytes.
+		//		alignment: Alignment of the memory, a power of two.
+		// Throws
+		//		std::bad_alloc if the arena is full.
+		void *allocate(size_t bytes, size_t alignment = 8);
+
+		// Constructs a default-initialized object in the arena.
+		template <class T>
+		T *create() { return new (allocate(sizeof(T), ALIGNMENT)) T(); }
+
+		// Releases every allocation made since the last reset.
+		void reset() { offset = 0; }
+
+		// Returns the number of bytes allocated since the last reset.
+		size_t used() { return offset; }
+
+		// Returns the most bytes ever allocated between resets.
+		size_t highWater() { return peak; }
+
+		// Returns the size of the buffer.
+		size_t capacity() { return size; }
+
+	private:
+		enum {
+			ALIGNMENT = 16  // Enough for any object created in the arena
+		};
+
+		char *buffer;
+		size_t size;
+		size_t offset;
+		size_t peak;
+
+		// Not copyable
+		FrameArena(FrameArena const&);
+		FrameArena &operator=(FrameArena const&);
+};
+
+#endif
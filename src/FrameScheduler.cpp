@@ -0,0 +1,125 @@
+#include "FrameScheduler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+// Time reserved before the deadline to absorb wake-up latency
+static const Clock::Nanoseconds SLEEP_MARGIN = 2000000LL;
+
+// Swap intervals outside this range are not used for the period estimate
+static const Clock::Nanoseconds MIN_PERIOD = 4000000LL;
+static const Clock::Nanoseconds MAX_PERIOD = 100000000LL;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+FrameScheduler::FrameScheduler(Clock::Nanoseconds nominalPeriod, int sampleCount)
+	: intervals(sampleCount), periodSum(0), sampleCount(sampleCount),
+	  workEstimate(0), lastFrameTime(0), frames(0), missed(0),
+	  jitterSum(0), jitterMax(0), jitterCount(0)
+{
+	// Prime the estimate with the nominal period
+	for (int i = 0; i < sampleCount; ++i) {
+		intervals.push(nominalPeriod);
+		periodSum += nominalPeriod;
+	}
+
+	reset();
+}
+
+void FrameScheduler::waitForNextFrame()
+{
+	Clock::Nanoseconds wakeTime = nextDeadline - workEstimate - SLEEP_MARGIN;
+	if (wakeTime > Clock::now()) {
+		Clock::sleepUntil(wakeTime);
+	}
+
+	frameStart = Clock::now();
+}
+
+void FrameScheduler::beginPresent()
+{
+	// Track the peak work time, decaying slowly so one fast frame doesn't cut the budget
+	Clock::Nanoseconds work = Clock::now() - frameStart;
+	if (work > workEstimate) {
+		workEstimate = work;
+	}
+	else {
+		workEstimate += (work - workEstimate) / 16;
+	}
+}
+
+void FrameScheduler::endPresent()
+{
+	Clock::Nanoseconds presentTime = Clock::now();
+	Clock::Nanoseconds currentPeriod = period();
+
+	// A swap that lands more than half a period late went out on a later refresh
+	Clock::Nanoseconds lateness = presentTime - nextDeadline;
+	if (lateness > currentPeriod / 2) {
+		++missed;
+	}
+
+	recordInterval(presentTime - lastPresent);
+	lastFrameTime = presentTime - frameStart;
+
+	lastPresent = presentTime;
+	nextDeadline = presentTime + period();
+	++frames;
+}
+
+void FrameScheduler::skipPresent()
+{
+	// Keep the phase of the last swap and move on to the next refresh
+	Clock::Nanoseconds now = Clock::now();
+	Clock::Nanoseconds currentPeriod = period();
+	do {
+		nextDeadline += currentPeriod;
+	} while (nextDeadline < now);
+}
+
+void FrameScheduler::reset()
+{
+	lastPresent = Clock::now();
+	nextDeadline = lastPresent + period();
+	frameStart = lastPresent;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * recordInterval
+ * Adds a swap interval to the display period estimate.
+ *
+ * Intervals spanning several refreshes are divided down to a single period.
+ * The deviation from a whole number of periods is recorded as jitter.
+ *
+ * Arguments
+ *     interval: Time between two consecutive swaps.
+ */
+void FrameScheduler::recordInterval(Clock::Nanoseconds interval)
+{
+	Clock::Nanoseconds currentPeriod = period();
+	Clock::Nanoseconds refreshes = (interval + currentPeriod / 2) / currentPeriod;
+	if (refreshes < 1) {
+		refreshes = 1;
+	}
+
+	Clock::Nanoseconds jitter = interval - refreshes * currentPeriod;
+	if (jitter < 0) {
+		jitter = -jitter;
+	}
+	jitterSum += jitter;
+	++jitterCount;
+	if (jitter > jitterMax) {
+		jitterMax = jitter;
+	}
+
+	Clock::Nanoseconds sample = interval / refreshes;
+	if (sample < MIN_PERIOD || sample > MAX_PERIOD) {
+		return;
+	}
+
+	periodSum += sample - intervals.push(sample);
+}
@@ -0,0 +1,76 @@
+#ifndef __FRAMESCHEDULER_H__
+#define __FRAMESCHEDULER_H__
+
+#include "Clock.h"
+#include "RingBuffer.h"
+
+/*
+ * FrameScheduler
+ * Paces the main loop to the display refresh.
+ *
+ * The scheduler measures the interval between buffer swaps to estimate the
+ * display period, and sleeps until just before the next frame deadline so that
+ * the frame's work finishes in time for the swap without spinning the CPU.
+ */
+class FrameScheduler {
+	public:
+		// Constructor
+		// Arguments
+		//		nominalPeriod: Initial estimate of the display period.
+		//		sampleCount:   Number of swap intervals averaged for the period estimate.
+		FrameScheduler(Clock::Nanoseconds nominalPeriod = 16666667LL, int sampleCount = 32);
+
+		// Sleeps until the frame's work should begin, then marks the start of the frame.
+		void waitForNextFrame();
+
+		// Marks the end of the frame's work, immediately before the buffer swap.
+		void beginPresent();
+
+		// Marks the return of the buffer swap.
+		void endPresent();
+
+		// Marks a frame that was not presented because nothing changed.
+		void skipPresent();
+
+		// Restarts deadline tracking, e.g. after the app has been paused.
+		void reset();
+
+		// Returns the estimated display period.
+		Clock::Nanoseconds period() { return periodSum / sampleCount; }
+
+		// Returns the time from the start of the last presented frame's work
+		// to the return of its buffer swap, which includes waiting on the GPU.
+		Clock::Nanoseconds frameTime() { return lastFrameTime; }
+
+		// Returns the number of frames presented.
+		int frameCount() { return frames; }
+
+		// Returns the number of frame deadlines that were missed.
+		int missedDeadlines() { return missed; }
+
+		// Returns the mean and largest deviation of swap intervals from a whole number of periods.
+		Clock::Nanoseconds meanJitter() { return jitterCount > 0 ? jitterSum / jitterCount : 0; }
+		Clock::Nanoseconds maxJitter() { return jitterMax; }
+
+	private:
+		RingBuffer<Clock::Nanoseconds> intervals;
+		Clock::Nanoseconds periodSum;
+		int sampleCount;
+
+		Clock::Nanoseconds frameStart;
+		Clock::Nanoseconds workEstimate;
+		Clock::Nanoseconds lastPresent;
+		Clock::Nanoseconds nextDeadline;
+		Clock::Nanoseconds lastFrameTime;
+
+		int frames;
+		int missed;
+
+		Clock::Nanoseconds jitterSum;
+		Clock::Nanoseconds jitterMax;
+		int jitterCount;
+
+		void recordInterval(Clock::Nanoseconds interval);
+};
+
+#endif
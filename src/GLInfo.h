@@ -0,0 +1,60 @@
+#ifndef __GLINFO_H__
+#define __GLINFO_H__
+
+#include <cstring>
+#include <string>
+
+#include <GLES2/gl2.h>
+
+/*
+ * GLInfo
+ * Queries the capabilities of the current GL context.
+ */
+class GLInfo {
+	public:
+		// Returns true if the driver advertises the named extension.
+		static bool hasExtension(const char *name)
+		{
+			const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+			if (extensions == NULL) {
+				return false;
+			}
+
+			// Match whole names only, as some extension names prefix others
+			size_t length = strlen(name);
+			for (const char *found = strstr(extensions, name); found != NULL; found = strstr(found + 1, name)) {
+				bool startsName = found == extensions || found[-1] == ' ';
+				bool endsName = found[length] == ' ' || found[length] == '\0';
+				if (startsName && endsName) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Returns true if textures may have non-power-of-two sizes, with
+		// GL_CLAMP_TO_EDGE wrapping and without mipmaps.
+		static bool supportsNPOT()
+		{
+			// OpenGL ES 2.0 allows this in core
+			const char *version = (const char *)glGetString(GL_VERSION);
+			if (version != NULL && strncmp(version, "OpenGL ES 2", 11) == 0) {
+				return true;
+			}
+
+			return hasExtension("GL_OES_texture_npot")
+				|| hasExtension("GL_ARB_texture_non_power_of_two")
+				|| hasExtension("GL_APPLE_texture_2D_limited_npot")
+				|| hasExtension("GL_IMG_texture_npot");
+		}
+
+		// Returns the largest supported texture width and height.
+		static int maxTextureSize()
+		{
+			int size;
+			glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+			return size;
+		}
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "GLState.h"
+
+#include <cassert>
+#include <cstddef>
+
+///////////////////////////////////////////////////////////////////////////////
+// Static members
+//
+// A freshly created context starts out in the default GL state.
+
+unsigned int GLState::program = 0;
+int GLState::activeUnit = 0;
+unsigned int GLState::textures[MAX_TEXTURE_UNITS] = { 0 };
+unsigned int GLState::arrayBuffer = 0;
+unsigned int GLState::framebuffer = 0;
+int GLState::viewportRect[4] = { 0, 0, 0, 0 };
+bool GLState::viewportKnown = false;  // The initial viewport is the window size
+GLState::AttribPointer GLState::attribPointers[MAX_VERTEX_ATTRIBS];
+unsigned int GLState::enabledAttributes = 0;
+unsigned int GLState::knownAttributes = ~0u;
+int GLState::cullFaceEnabled = 0;
+GLenum GLState::cullFaceMode = GL_BACK;
+int GLState::unpackAlign = 4;
+float GLState::clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+bool GLState::clearKnown = true;
+
+unsigned int GLState::issued = 0;
+unsigned int GLState::elided = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+void GLState::useProgram(unsigned int program)
+{
+	if (GLState::program == program) {
+		++elided;
+		return;
+	}
+
+	glUseProgram(program);
+	GLState::program = program;
+	++issued;
+}
+
+void GLState::bindTexture(int unit, unsigned int texture)
+{
+	assert(unit >= 0 && unit < MAX_TEXTURE_UNITS);
+	if (textures[unit] == texture) {
+		++elided;
+		return;
+	}
+
+	activeTexture(unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	textures[unit] = texture;
+	++issued;
+}
+
+void GLState::bindArrayBuffer(unsigned int buffer)
+{
+	if (arrayBuffer == buffer) {
+		++elided;
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	arrayBuffer = buffer;
+	++issued;
+}
+
+void GLState::bindFramebuffer(unsigned int framebuffer)
+{
+	if (GLState::framebuffer == framebuffer) {
+		++elided;
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLState::framebuffer = framebuffer;
+	++issued;
+}
+
+void GLState::viewport(int x, int y, int width, int height)
+{
+	if (viewportKnown && viewportRect[0] == x && viewportRect[1] == y
+		&& viewportRect[2] == width && viewportRect[3] == height)
+	{
+		++elided;
+		return;
+	}
+
+	glViewport(x, y, width, height);
+	viewportRect[0] = x;
+	viewportRect[1] = y;
+	viewportRect[2] = width;
+	viewportRect[3] = height;
+	viewportKnown = true;
+	++issued;
+}
+
+void GLState::vertexAttribPointer(unsigned int index, int size, int stride, unsigned int offset)
+{
+	AttribPointer &pointer = attribPointers[index];
+	if (pointer.buffer == arrayBuffer && pointer.size == size
+		&& pointer.stride == stride && pointer.offset == offset)
+	{
+		++elided;
+		return;
+	}
+
+	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, (const char *)NULL + offset);
+	pointer.buffer = arrayBuffer;
+	pointer.size = size;
+	pointer.stride = stride;
+	pointer.offset = offset;
+	++issued;
+}
+
+void GLState::enableVertexAttribArray(unsigned int index)
+{
+	unsigned int bit = 1u << index;
+	if ((knownAttributes & bit) && (enabledAttributes & bit)) {
+		++elided;
+		return;
+	}
+
+	glEnableVertexAttribArray(index);
+	enabledAttributes |= bit;
+	knownAttributes |= bit;
+	++issued;
+}
+
+void GLState::disableVertexAttribArray(unsigned int index)
+{
+	unsigned int bit = 1u << index;
+	if ((knownAttributes & bit) && !(enabledAttributes & bit)) {
+		++elided;
+		return;
+	}
+
+	glDisableVertexAttribArray(index);
+	enabledAttributes &= ~bit;
+	knownAttributes |= bit;
+	++issued;
+}
+
+void GLState::cullFace(bool enabled, GLenum mode)
+{
+	if (cullFaceEnabled != (int)enabled) {
+		if (enabled) {
+			glEnable(GL_CULL_FACE);
+		}
+		else {
+			glDisable(GL_CULL_FACE);
+		}
+		cullFaceEnabled = enabled;
+		++issued;
+	}
+	else {
+		++elided;
+	}
+
+	if (enabled) {
+		if (cullFaceMode != mode) {
+			glCullFace(mode);
+			cullFaceMode = mode;
+			++issued;
+		}
+		else {
+			++elided;
+		}
+	}
+}
+
+void GLState::unpackAlignment(int alignment)
+{
+	if (unpackAlign == alignment) {
+		++elided;
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	unpackAlign = alignment;
+	++issued;
+}
+
+void GLState::clearColor(float r, float g, float b, float a)
+{
+	if (clearKnown && clear[0] == r && clear[1] == g && clear[2] == b && clear[3] == a) {
+		++elided;
+		return;
+	}
+
+	glClearColor(r, g, b, a);
+	clear[0] = r;
+	clear[1] = g;
+	clear[2] = b;
+	clear[3] = a;
+	clearKnown = true;
+	++issued;
+}
+
+void GLState::deleteTextures(int count, const unsigned int *textures)
+{
+	glDeleteTextures(count, textures);
+
+	// Deleting a bound texture reverts the binding to 0
+	for (int i = 0; i < count; ++i) {
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+			if (GLState::textures[unit] == textures[i]) {
+				GLState::textures[unit] = 0;
+			}
+		}
+	}
+}
+
+void GLState::deleteBuffers(int count, const unsigned int *buffers)
+{
+	glDeleteBuffers(count, buffers);
+
+	// Deleting a bound buffer reverts the binding to 0
+	for (int i = 0; i < count; ++i) {
+		if (arrayBuffer == buffers[i]) {
+			arrayBuffer = 0;
+		}
+		for (int index = 0; index < MAX_VERTEX_ATTRIBS; ++index) {
+			if (attribPointers[index].buffer == buffers[i]) {
+				attribPointers[index].size = 0;
+			}
+		}
+	}
+}
+
+void GLState::deleteFramebuffers(int count, const unsigned int *framebuffers)
+{
+	glDeleteFramebuffers(count, framebuffers);
+
+	// Deleting the bound framebuffer reverts the binding to the window's
+	for (int i = 0; i < count; ++i) {
+		if (framebuffer == framebuffers[i]) {
+			framebuffer = 0;
+		}
+	}
+}
+
+void GLState::invalidate()
+{
+	program = ~0u;
+	activeUnit = UNKNOWN;
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+		textures[unit] = ~0u;
+	}
+	arrayBuffer = ~0u;
+	framebuffer = ~0u;
+	viewportKnown = false;
+	for (int index = 0; index < MAX_VERTEX_ATTRIBS; ++index) {
+		attribPointers[index].size = 0;
+	}
+	knownAttributes = 0;
+	cullFaceEnabled = UNKNOWN;
+	cullFaceMode = 0;
+	unpackAlign = UNKNOWN;
+	clearKnown = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * activeTexture
+ * Selects the active texture unit.
+ *
+ * Arguments
+ *     unit: Index of the texture unit, starting at 0 for GL_TEXTURE0.
+ */
+void GLState::activeTexture(int unit)
+{
+	if (activeUnit == unit) {
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	++issued;
+}
@@ -0,0 +1,113 @@
+#ifndef __GLSTATE_H__
+#define __GLSTATE_H__
+
+#include <GLES2/gl2.h>
+
+/*
+ * GLState
+ * Shadows GL state on the render thread, and only forwards state changes
+ * to GL when they actually change something.
+ *
+ * All changes to the tracked state must go through this class, or the
+ * shadow copy must be thrown away with invalidate().
+ */
+class GLState {
+	public:
+		// Makes a program current.
+		static void useProgram(unsigned int program);
+
+		// Binds a 2D texture to a texture unit.
+		// Arguments
+		//		unit:    Index of the texture unit, starting at 0 for GL_TEXTURE0; at most 7
+		//		texture: Handle of the GL texture
+		static void bindTexture(int unit, unsigned int texture);
+
+		// Binds a buffer to GL_ARRAY_BUFFER.
+		static void bindArrayBuffer(unsigned int buffer);
+
+		// Binds a framebuffer object, or 0 for the window's framebuffer.
+		static void bindFramebuffer(unsigned int framebuffer);
+
+		// Sets the viewport rectangle.
+		static void viewport(int x, int y, int width, int height);
+
+		// Points a vertex attribute at the bound array buffer.
+		// Arguments
+		//		index:  Index of the vertex attribute
+		//		size:   Number of floats per vertex
+		//		stride: Bytes between consecutive vertices, or 0 if tightly packed
+		//		offset: Byte offset of the first vertex in the buffer
+		static void vertexAttribPointer(unsigned int index, int size, int stride, unsigned int offset);
+
+		// Enables or disables a vertex attribute array.
+		static void enableVertexAttribArray(unsigned int index);
+		static void disableVertexAttribArray(unsigned int index);
+
+		// Enables or disables face culling.
+		// Arguments
+		//		enabled: Whether GL_CULL_FACE is enabled
+		//		mode:    Faces to cull, if enabled
+		static void cullFace(bool enabled, GLenum mode = GL_BACK);
+
+		// Sets the row alignment of pixel data passed to glTexImage2D and glTexSubImage2D.
+		static void unpackAlignment(int alignment);
+
+		// Sets the clear color.
+		static void clearColor(float r, float g, float b, float a);
+
+		// Deletes textures, forgetting any bindings to them.
+		static void deleteTextures(int count, const unsigned int *textures);
+
+		// Deletes buffers, forgetting any bindings to them.
+		static void deleteBuffers(int count, const unsigned int *buffers);
+
+		// Deletes framebuffer objects, forgetting any bindings to them.
+		static void deleteFramebuffers(int count, const unsigned int *framebuffers);
+
+		// Forgets all shadowed state, so the next change to each is forwarded.
+		static void invalidate();
+
+		// Returns the number of state changes forwarded to GL.
+		static unsigned int callsIssued() { return issued; }
+
+		// Returns the number of redundant state changes that were dropped.
+		static unsigned int callsElided() { return elided; }
+
+	private:
+		enum {
+			MAX_TEXTURE_UNITS = 8,
+			MAX_VERTEX_ATTRIBS = 8,
+			UNKNOWN = -1
+		};
+
+		// Source of a vertex attribute array
+		struct AttribPointer {
+			unsigned int buffer;
+			int size;
+			int stride;
+			unsigned int offset;
+		};
+
+		static unsigned int program;
+		static int activeUnit;
+		static unsigned int textures[MAX_TEXTURE_UNITS];
+		static unsigned int arrayBuffer;
+		static unsigned int framebuffer;
+		static int viewportRect[4];       // x, y, width, height
+		static bool viewportKnown;
+		static AttribPointer attribPointers[MAX_VERTEX_ATTRIBS];
+		static unsigned int enabledAttributes;  // Bit set of enabled arrays
+		static unsigned int knownAttributes;    // Bit set of arrays with known state
+		static int cullFaceEnabled;
+		static GLenum cullFaceMode;
+		static int unpackAlign;
+		static float clear[4];
+		static bool clearKnown;
+
+		static unsigned int issued;
+		static unsigned int elided;
+
+		static void activeTexture(int unit);
+};
+
+#endif
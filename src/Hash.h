@@ -0,0 +1,65 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Hash
+ * 64-bit FNV-1a hashing, for keying caches on file contents.
+ *
+ * Hashes can be chained by passing the previous hash as the seed, so several
+ * buffers hash as if they were one.
+ */
+class Hash {
+	public:
+		typedef unsigned long long Value;
+
+		static const Value OFFSET_BASIS = 14695981039346656037ULL;
+
+		// Hashes a buffer.
+		// Arguments
+		//		data: The bytes to hash.
+		//		size: Number of bytes.
+		//		seed: OFFSET_BASIS, or the hash of the preceding data.
+		static Value fnv1a(const void *data, size_t size, Value seed = OFFSET_BASIS)
+		{
+			const unsigned char *bytes = (const unsigned char *)data;
+			Value hash = seed;
+			for (size_t i = 0; i < size; ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		// Hashes a string, without its terminator.
+		static Value fnv1a(std::string const& text, Value seed = OFFSET_BASIS)
+		{
+			return fnv1a(text.data(), text.size(), seed);
+		}
+
+		// Hashes an integer, byte by byte from the least significant.
+		static Value fnv1a(long long value, Value seed)
+		{
+			unsigned char bytes[8];
+			for (int i = 0; i < 8; ++i) {
+				bytes[i] = (unsigned char)(value >> (i * 8));
+			}
+			return fnv1a(bytes, sizeof(bytes), seed);
+		}
+
+		// Returns a hash as 16 hexadecimal digits.
+		static std::string toHex(Value hash)
+		{
+			static const char DIGITS[] = "0123456789abcdef";
+			char text[17];
+			for (int i = 15; i >= 0; --i, hash >>= 4) {
+				text[i] = DIGITS[hash & 15];
+			}
+			text[16] = '\0';
+			return text;
+		}
+};
+
+#endif
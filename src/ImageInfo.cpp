@@ -0,0 +1,93 @@
+#include "ImageInfo.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+bool ImageInfo::read(std::string const& filename, ImageInfo &info)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	unsigned char signature[2];
+	bool success = false;
+	if (fread(signature, 1, 2, file) == 2) {
+		if (signature[0] == 0xFF && signature[1] == 0xD8) {
+			success = readJPEG(file, info);
+		}
+		else if (signature[0] == 0x89 && signature[1] == 'P') {
+			success = readPNG(file, info);
+		}
+	}
+
+	fclose(file);
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * readJPEG
+ * Walks the JPEG marker segments up to the start-of-frame marker.
+ * The file must be positioned just after the SOI marker.
+ */
+bool ImageInfo::readJPEG(FILE *file, ImageInfo &info)
+{
+	unsigned char segment[8];
+	while (true) {
+		// Markers may be preceded by any number of fill bytes
+		int marker;
+		do {
+			marker = fgetc(file);
+		} while (marker == 0xFF);
+		if (marker == EOF) {
+			return false;
+		}
+
+		if (fread(segment, 1, 2, file) != 2) {
+			return false;
+		}
+		int length = (segment[0] << 8) | segment[1];
+
+		// SOF0..SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (fread(segment, 1, 6, file) != 6) {
+				return false;
+			}
+			info.height = (segment[1] << 8) | segment[2];
+			info.width  = (segment[3] << 8) | segment[4];
+			info.hasAlpha = false;
+			return true;
+		}
+
+		// Skip to the next marker; the length includes its own two bytes
+		if (length < 2 || fseek(file, length - 2, SEEK_CUR) != 0) {
+			return false;
+		}
+	}
+}
+
+/*
+ * readPNG
+ * Reads the IHDR chunk, which always comes first.
+ * The file must be positioned just after the first two signature bytes.
+ */
+bool ImageInfo::readPNG(FILE *file, ImageInfo &info)
+{
+	// Rest of the signature, IHDR length and type, then the IHDR data
+	unsigned char header[6 + 8 + 13];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+		return false;
+	}
+
+	const unsigned char *ihdr = header + 14;
+	info.width  = (ihdr[0] << 24) | (ihdr[1] << 16) | (ihdr[2] << 8) | ihdr[3];
+	info.height = (ihdr[4] << 24) | (ihdr[5] << 16) | (ihdr[6] << 8) | ihdr[7];
+
+	// Grayscale+alpha or RGBA; palette transparency isn't detected
+	int colorType = ihdr[9];
+	info.hasAlpha = (colorType == 4 || colorType == 6);
+	return true;
+}
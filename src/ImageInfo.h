@@ -0,0 +1,30 @@
+#ifndef __IMAGEINFO_H__
+#define __IMAGEINFO_H__
+
+#include <cstdio>
+#include <string>
+
+/*
+ * ImageInfo
+ * Reads the dimensions of an image file from its header, without decoding it.
+ * Understands JPEG and PNG files.
+ */
+struct ImageInfo {
+	int width;
+	int height;
+	bool hasAlpha;
+
+	// Reads the header of an image file.
+	// Arguments
+	//		filename: Filename of the image file.
+	//		info:     Receives the image properties.
+	// Returns
+	//		false if the file couldn't be read or isn't a JPEG or PNG file.
+	static bool read(std::string const& filename, ImageInfo &info);
+
+	private:
+		static bool readJPEG(FILE *file, ImageInfo &info);
+		static bool readPNG(FILE *file, ImageInfo &info);
+};
+
+#endif
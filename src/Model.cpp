@@ -14,10 +14,9 @@ Model::Model(Accelerometer *accelerometer, float sensitivity, float minX, float
 	this->a = 0.0f;
 }
 
-void Model::tick(const int dt)
+void Model::tick(const float dt, float acceleration)
 {
-	float acceleration = accelerometer->getSingleAxisYAcceleration() * sensitivity;
-	calculatePhysics(acceleration, 0.001f * dt);
+	calculatePhysics(acceleration * sensitivity, dt);
 	
 	// Limit position to bounds
 	// If the model hits the bounds, set v and a to zero
@@ -33,8 +32,10 @@ void Model::tick(const int dt)
 		this->a = 0.0f;		
 	}
 
+#ifdef DEBUG
 	printf("X: %.5f, V: %.5f, A: %.5f\n",
 			this->x, this->v, this->a);
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
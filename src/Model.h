@@ -4,7 +4,7 @@
 #include "SDL.h"
 
 #include "Accelerometer.h"
-#include "Vector3f.h"
+#include "Vector4f.h"
 
 /*
  * Model
@@ -27,8 +27,11 @@ class Model {
 		// Returns the current acceleration
 		float acceleration() { return this->a; }
 
-		// Updates the model state given a change in time.
-		void tick(const int dt);
+		// Updates the model state given a change in time and an accelerometer sample.
+		// Arguments
+		//		dt:           Change in time, in seconds
+		//		acceleration: Result of Accelerometer::getSingleAxisYAcceleration()
+		void tick(const float dt, float acceleration);
 
 	private:
 		Accelerometer *accelerometer;
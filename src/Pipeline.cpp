@@ -0,0 +1,175 @@
+#include "Pipeline.h"
+
+#include "Profiler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+Pipeline::Pipeline(Accelerometer *accelerometer, Model *model, Clock::Nanoseconds dt, Clock::Nanoseconds maxFrameTime)
+	: accelerometer(accelerometer), model(model), dt(dt), maxFrameTime(maxFrameTime),
+	  samples(0.0f), inputThread(NULL), simulationThread(NULL),
+	  running(false), paused(false)
+{
+	pauseMutex = SDL_CreateMutex();
+	pauseCondition = SDL_CreateCond();
+}
+
+Pipeline::~Pipeline()
+{
+	stop();
+	SDL_DestroyCond(pauseCondition);
+	SDL_DestroyMutex(pauseMutex);
+}
+
+void Pipeline::start()
+{
+	if (running) {
+		return;
+	}
+
+	// The input thread polls the joystick itself, so keep the event loop
+	// on the main thread from updating it concurrently
+	SDL_JoystickEventState(SDL_IGNORE);
+
+	running = true;
+	inputThread = SDL_CreateThread(inputThreadMain, this);
+	simulationThread = SDL_CreateThread(simulationThreadMain, this);
+}
+
+void Pipeline::stop()
+{
+	if (!running) {
+		return;
+	}
+
+	SDL_LockMutex(pauseMutex);
+	running = false;
+	SDL_CondBroadcast(pauseCondition);
+	SDL_UnlockMutex(pauseMutex);
+
+	SDL_WaitThread(inputThread, NULL);
+	SDL_WaitThread(simulationThread, NULL);
+	inputThread = NULL;
+	simulationThread = NULL;
+}
+
+void Pipeline::setPaused(bool paused)
+{
+	SDL_LockMutex(pauseMutex);
+	this->paused = paused;
+	SDL_CondBroadcast(pauseCondition);
+	SDL_UnlockMutex(pauseMutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+int Pipeline::inputThreadMain(void *pipeline)
+{
+	((Pipeline *)pipeline)->runInput();
+	return 0;
+}
+
+int Pipeline::simulationThreadMain(void *pipeline)
+{
+	((Pipeline *)pipeline)->runSimulation();
+	return 0;
+}
+
+/*
+ * runInput
+ * Input thread loop. Samples the accelerometer at twice the simulation rate,
+ * so every simulation step sees a fresh sample.
+ */
+void Pipeline::runInput()
+{
+	const Clock::Nanoseconds samplePeriod = dt / 2;
+
+	while (waitWhilePaused()) {
+		SDL_JoystickUpdate();
+		samples.write(accelerometer->getSingleAxisYAcceleration());
+
+		Clock::sleepUntil(Clock::now() + samplePeriod);
+	}
+}
+
+/*
+ * runSimulation
+ * Simulation thread loop. Advances the model in fixed steps of dt and
+ * publishes a snapshot after every batch of steps.
+ */
+void Pipeline::runSimulation()
+{
+	Clock::Nanoseconds currentTime = Clock::now(),
+					   newTime = 0,
+					   frameTime = 0,
+					   accumulator = 0,
+					   t = 0;
+	unsigned int step = 0;
+
+	while (waitWhilePaused()) {
+		newTime = Clock::now();
+		frameTime = newTime - currentTime;
+		if (frameTime > maxFrameTime) {
+			frameTime = maxFrameTime;
+		}
+		currentTime = newTime;
+		accumulator += frameTime;
+
+		bool stepped = false;
+		while (accumulator >= dt) {
+			update(t, dt);
+			accumulator -= dt;
+			t += dt;
+			++step;
+			stepped = true;
+		}
+
+		if (stepped) {
+			ModelState &state = states.writeBuffer();
+			state.x = model->position();
+			state.v = model->velocity();
+			state.a = model->acceleration();
+			state.t = t;
+			state.step = step;
+			states.publish();
+		}
+
+		// Sleep until the next step is due
+		Clock::sleepUntil(newTime + dt - accumulator);
+	}
+}
+
+/*
+ * update
+ * Advances the simulation by a single step.
+ *
+ * Arguments
+ *     t:  Simulation time at the start of the step.
+ *     dt: Length of the step.
+ */
+void Pipeline::update(const Clock::Nanoseconds t, const Clock::Nanoseconds dt)
+{
+	PROFILE_SCOPE(PROFILE_UPDATE);
+	model->tick(Clock::toSeconds(dt), samples.read());
+}
+
+/*
+ * waitWhilePaused
+ * Blocks the calling thread while the pipeline is paused.
+ *
+ * Returns
+ *     false if the pipeline has been stopped.
+ */
+bool Pipeline::waitWhilePaused()
+{
+	if (paused) {
+		SDL_LockMutex(pauseMutex);
+		while (paused && running) {
+			SDL_CondWait(pauseCondition, pauseMutex);
+		}
+		SDL_UnlockMutex(pauseMutex);
+	}
+
+	return running;
+}
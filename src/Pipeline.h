@@ -0,0 +1,84 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "SDL.h"
+
+#include "Accelerometer.h"
+#include "Clock.h"
+#include "Model.h"
+#include "TripleBuffer.h"
+
+/*
+ * ModelState
+ * Snapshot of the model, published by the simulation thread for rendering.
+ */
+struct ModelState {
+	float x, v, a;
+	Clock::Nanoseconds t;  // Simulation time
+	unsigned int step;     // Number of steps simulated so far
+
+	ModelState() : x(0.0f), v(0.0f), a(0.0f), t(0), step(0) {}
+};
+
+/*
+ * Pipeline
+ * Runs accelerometer acquisition and the fixed-step simulation on their own
+ * threads, leaving the calling thread free for events and GL rendering.
+ *
+ * Samples flow from the input thread to the simulation thread, and model
+ * snapshots from the simulation thread to the render thread, through
+ * lock-free triple buffers, so no stage ever waits on another.
+ */
+class Pipeline {
+	public:
+		// Constructor
+		// Arguments
+		//		accelerometer: An Accelerometer instance, sampled on the input thread
+		//		model:         A Model instance, owned by the simulation thread once started
+		//		dt:            Fixed simulation step
+		//		maxFrameTime:  Longest stretch of time simulated at once
+		Pipeline(Accelerometer *accelerometer, Model *model,
+				 Clock::Nanoseconds dt = 16666667LL, Clock::Nanoseconds maxFrameTime = 250000000LL);
+
+		// Destructor
+		~Pipeline();
+
+		// Starts the input and simulation threads.
+		void start();
+
+		// Stops and joins the input and simulation threads.
+		void stop();
+
+		// Suspends or resumes the input and simulation threads.
+		void setPaused(bool paused);
+
+		// Returns the most recently simulated model state.
+		// Only call this from a single (render) thread.
+		ModelState const& latestState() { return states.read(); }
+
+	private:
+		Accelerometer *accelerometer;
+		Model *model;
+		Clock::Nanoseconds dt;
+		Clock::Nanoseconds maxFrameTime;
+
+		TripleBuffer<float> samples;      // Input -> simulation
+		TripleBuffer<ModelState> states;  // Simulation -> render
+
+		SDL_Thread *inputThread;
+		SDL_Thread *simulationThread;
+
+		SDL_mutex *pauseMutex;
+		SDL_cond *pauseCondition;
+		volatile bool running;
+		volatile bool paused;
+
+		static int inputThreadMain(void *pipeline);
+		static int simulationThreadMain(void *pipeline);
+		void runInput();
+		void runSimulation();
+		void update(const Clock::Nanoseconds t, const Clock::Nanoseconds dt);
+		bool waitWhilePaused();
+};
+
+#endif
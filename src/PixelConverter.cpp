@@ -0,0 +1,201 @@
+#include "PixelConverter.h"
+
+#include <cstddef>
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+// Thresholds of the 4x4 ordered dither, 0..15
+const unsigned char PixelConverter::BAYER[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 }
+};
+
+// Clamps a dithered channel to 255
+static inline unsigned int saturate(unsigned int value)
+{
+	return value > 255 ? 255 : value;
+}
+
+// Four bytes of pixel data read as one word. Both targets are little endian,
+// so the first byte is the lowest.
+typedef unsigned int PackedBytes __attribute__((may_alias));
+
+// Adds each byte of b to the same byte of a, clamping the sums to 255
+static inline unsigned int saturatingAdd8(unsigned int a, unsigned int b)
+{
+#if (defined(__ARM_ARCH_6__) || defined(__ARM_ARCH_6J__) || defined(__ARM_ARCH_6K__) \
+		|| defined(__ARM_ARCH_6Z__) || defined(__ARM_ARCH_6ZK__)) && !defined(__thumb__) \
+		|| defined(__ARM_ARCH_7A__)
+	unsigned int sum;
+	asm("uqadd8 %0, %1, %2" : "=r" (sum) : "r" (a), "r" (b));
+	return sum;
+#else
+	// Add the low 7 bits, which can't carry into the next byte, then the top
+	// bits without carrying, and saturate the bytes that carried out
+	unsigned int sum = ((a & 0x7f7f7f7f) + (b & 0x7f7f7f7f)) ^ ((a ^ b) & 0x80808080);
+	unsigned int carries = ((a & b) | ((a | b) & ~sum)) & 0x80808080;
+	return sum | (carries >> 7) * 0xff;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+void PixelConverter::toRGB565(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height)
+{
+	for (int y = 0; y < height; ++y, src += srcPitch, dst += width) {
+		rowToRGB565(src, dst, width, y);
+	}
+}
+
+void PixelConverter::toRGBA4444(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height)
+{
+	for (int y = 0; y < height; ++y, src += srcPitch, dst += width) {
+		rowToRGBA4444(src, dst, width, y);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * rowToRGB565
+ * Converts a row of RGB pixels to RGB565.
+ *
+ * The dither threshold is scaled to the bits each channel loses: 0..7 for
+ * the 5 bit channels and 0..3 for the 6 bit green channel.
+ *
+ * Arguments
+ *     src:   Source pixels.
+ *     dst:   Receives the texels.
+ *     width: Number of pixels in the row.
+ *     y:     Index of the row, which selects the dither pattern.
+ */
+void PixelConverter::rowToRGB565(const unsigned char *src, unsigned short *dst, int width, int y)
+{
+	const unsigned char *pattern = BAYER[y & 3];
+	int x = 0;
+
+#ifdef __ARM_NEON__
+	const unsigned char pattern8[8] = {
+		pattern[0], pattern[1], pattern[2], pattern[3],
+		pattern[0], pattern[1], pattern[2], pattern[3]
+	};
+	uint8x8_t bias5 = vshr_n_u8(vld1_u8(pattern8), 1);
+	uint8x8_t bias6 = vshr_n_u8(vld1_u8(pattern8), 2);
+
+	for (; x + 8 <= width; x += 8) {
+		uint8x8x3_t rgb = vld3_u8(src + x * 3);
+		uint8x8_t r = vshr_n_u8(vqadd_u8(rgb.val[0], bias5), 3);
+		uint8x8_t g = vshr_n_u8(vqadd_u8(rgb.val[1], bias6), 2);
+		uint8x8_t b = vshr_n_u8(vqadd_u8(rgb.val[2], bias5), 3);
+
+		uint16x8_t texels = vshlq_n_u16(vmovl_u8(r), 11);
+		texels = vorrq_u16(texels, vshlq_n_u16(vmovl_u8(g), 5));
+		texels = vorrq_u16(texels, vmovl_u8(b));
+		vst1q_u16(dst + x, texels);
+	}
+#endif
+
+	// 4 pixels at a time, as 3 words whose bytes are dithered together.
+	// Surface rows start on word boundaries, so every fourth pixel does too.
+	if (((size_t)src & 3) == 0) {
+		unsigned int r[4], g[4];
+		for (int i = 0; i < 4; ++i) {
+			r[i] = pattern[i] >> 1;  // Blue takes the same bias as red
+			g[i] = pattern[i] >> 2;
+		}
+		unsigned int bias0 = r[0] | g[0] << 8 | r[0] << 16 | r[1] << 24;  // r g b r
+		unsigned int bias1 = g[1] | r[1] << 8 | r[2] << 16 | g[2] << 24;  // g b r g
+		unsigned int bias2 = r[2] | r[3] << 8 | g[3] << 16 | r[3] << 24;  // b r g b
+
+		for (; x + 4 <= width; x += 4) {
+			const PackedBytes *words = (const PackedBytes *)(src + x * 3);
+			unsigned int w0 = saturatingAdd8(words[0], bias0);
+			unsigned int w1 = saturatingAdd8(words[1], bias1);
+			unsigned int w2 = saturatingAdd8(words[2], bias2);
+
+			dst[x]     = (unsigned short)((w0 >> 3 & 0x1f) << 11 | (w0 >> 10 & 0x3f) << 5 | (w0 >> 19 & 0x1f));
+			dst[x + 1] = (unsigned short)((w0 >> 27) << 11        | (w1 >> 2 & 0x3f) << 5  | (w1 >> 11 & 0x1f));
+			dst[x + 2] = (unsigned short)((w1 >> 19 & 0x1f) << 11 | (w1 >> 26) << 5        | (w2 >> 3 & 0x1f));
+			dst[x + 3] = (unsigned short)((w2 >> 11 & 0x1f) << 11 | (w2 >> 18 & 0x3f) << 5 | (w2 >> 27));
+		}
+	}
+
+	for (; x < width; ++x) {
+		const unsigned char *pixel = src + x * 3;
+		unsigned int threshold = pattern[x & 3];
+		unsigned int r = saturate(pixel[0] + (threshold >> 1)) >> 3;
+		unsigned int g = saturate(pixel[1] + (threshold >> 2)) >> 2;
+		unsigned int b = saturate(pixel[2] + (threshold >> 1)) >> 3;
+		dst[x] = (unsigned short)(r << 11 | g << 5 | b);
+	}
+}
+
+/*
+ * rowToRGBA4444
+ * Converts a row of RGBA pixels to RGBA4444.
+ *
+ * Arguments
+ *     src:   Source pixels.
+ *     dst:   Receives the texels.
+ *     width: Number of pixels in the row.
+ *     y:     Index of the row, which selects the dither pattern.
+ */
+void PixelConverter::rowToRGBA4444(const unsigned char *src, unsigned short *dst, int width, int y)
+{
+	const unsigned char *pattern = BAYER[y & 3];
+	int x = 0;
+
+#ifdef __ARM_NEON__
+	const unsigned char pattern8[8] = {
+		pattern[0], pattern[1], pattern[2], pattern[3],
+		pattern[0], pattern[1], pattern[2], pattern[3]
+	};
+	uint8x8_t bias = vld1_u8(pattern8);
+
+	for (; x + 8 <= width; x += 8) {
+		uint8x8x4_t rgba = vld4_u8(src + x * 4);
+		uint8x8_t r = vshr_n_u8(vqadd_u8(rgba.val[0], bias), 4);
+		uint8x8_t g = vshr_n_u8(vqadd_u8(rgba.val[1], bias), 4);
+		uint8x8_t b = vshr_n_u8(vqadd_u8(rgba.val[2], bias), 4);
+		uint8x8_t a = vshr_n_u8(vqadd_u8(rgba.val[3], bias), 4);
+
+		uint16x8_t texels = vshlq_n_u16(vmovl_u8(r), 12);
+		texels = vorrq_u16(texels, vshlq_n_u16(vmovl_u8(g), 8));
+		texels = vorrq_u16(texels, vshlq_n_u16(vmovl_u8(b), 4));
+		texels = vorrq_u16(texels, vmovl_u8(a));
+		vst1q_u16(dst + x, texels);
+	}
+#endif
+
+	// A pixel per word, with the same bias for every channel
+	if (((size_t)src & 3) == 0) {
+		unsigned int bias[4];
+		for (int i = 0; i < 4; ++i) {
+			bias[i] = pattern[i] * 0x01010101;
+		}
+
+		for (; x + 4 <= width; x += 4) {
+			const PackedBytes *words = (const PackedBytes *)(src + x * 4);
+			for (int i = 0; i < 4; ++i) {
+				unsigned int w = saturatingAdd8(words[i], bias[i]);
+				dst[x + i] = (unsigned short)((w >> 4 & 0xf) << 12 | (w >> 12 & 0xf) << 8 | (w >> 20 & 0xf) << 4 | w >> 28);
+			}
+		}
+	}
+
+	for (; x < width; ++x) {
+		const unsigned char *pixel = src + x * 4;
+		unsigned int threshold = pattern[x & 3];
+		unsigned int r = saturate(pixel[0] + threshold) >> 4;
+		unsigned int g = saturate(pixel[1] + threshold) >> 4;
+		unsigned int b = saturate(pixel[2] + threshold) >> 4;
+		unsigned int a = saturate(pixel[3] + threshold) >> 4;
+		dst[x] = (unsigned short)(r << 12 | g << 8 | b << 4 | a);
+	}
+}
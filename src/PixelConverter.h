@@ -0,0 +1,39 @@
+#ifndef __PIXELCONVERTER_H__
+#define __PIXELCONVERTER_H__
+
+/*
+ * PixelConverter
+ * Converts 8 bit per channel pixels to 16 bit texture formats.
+ *
+ * Both conversions apply a 4x4 ordered (Bayer) dither before dropping the low
+ * bits of each channel, which hides the banding of smooth gradients. The
+ * dither pattern is fixed to image coordinates, so it doesn't crawl between
+ * frames. Rows are converted 8 pixels at a time with NEON where available,
+ * and otherwise 4 bytes per word, with ARMv6 SIMD instructions on the device.
+ */
+class PixelConverter {
+	public:
+		// Converts RGB pixels to GL_UNSIGNED_SHORT_5_6_5.
+		// Arguments
+		//		src:      Source pixels, 3 bytes each.
+		//		srcPitch: Bytes between the starts of source rows.
+		//		dst:      Receives width * height tightly packed texels.
+		//		width, height: Size of the image.
+		static void toRGB565(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height);
+
+		// Converts RGBA pixels to GL_UNSIGNED_SHORT_4_4_4_4.
+		// Arguments
+		//		src:      Source pixels, 4 bytes each.
+		//		srcPitch: Bytes between the starts of source rows.
+		//		dst:      Receives width * height tightly packed texels.
+		//		width, height: Size of the image.
+		static void toRGBA4444(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height);
+
+	private:
+		static const unsigned char BAYER[4][4];
+
+		static void rowToRGB565(const unsigned char *src, unsigned short *dst, int width, int y);
+		static void rowToRGBA4444(const unsigned char *src, unsigned short *dst, int width, int y);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "Profiler.h"
+
+#ifdef PROFILING
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "json/value.h"
+#include "json/writer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// ProfileHistogram
+
+void ProfileHistogram::record(Clock::Nanoseconds duration)
+{
+	if (duration < 0) {
+		duration = 0;
+	}
+
+	++buckets[bucketIndex(duration)];
+	if (total == 0 || duration < min) {
+		min = duration;
+	}
+	if (duration > max) {
+		max = duration;
+	}
+	++total;
+}
+
+void ProfileHistogram::clear()
+{
+	memset(buckets, 0, sizeof(buckets));
+	total = 0;
+	min = 0;
+	max = 0;
+}
+
+Clock::Nanoseconds ProfileHistogram::percentile(double p)
+{
+	if (total == 0) {
+		return 0;
+	}
+
+	unsigned int target = (unsigned int)(p / 100.0 * total + 0.5);
+	if (target < 1)     { target = 1; }
+	if (target > total) { target = total; }
+
+	unsigned int seen = 0;
+	for (int index = 0; index < BUCKET_COUNT; ++index) {
+		seen += buckets[index];
+		if (seen >= target) {
+			Clock::Nanoseconds upperBound = bucketLowerBound(index + 1) - 1;
+			return upperBound < max ? upperBound : max;
+		}
+	}
+	return max;
+}
+
+/*
+ * bucketIndex
+ * Returns the bucket for a duration. Durations below SUB_BUCKETS get a bucket
+ * each; above that, every power of two is split into SUB_BUCKETS buckets.
+ */
+int ProfileHistogram::bucketIndex(Clock::Nanoseconds duration)
+{
+	unsigned long long value = duration;
+	if (value < SUB_BUCKETS) {
+		return (int)value;
+	}
+
+	int exponent = 63 - __builtin_clzll(value);
+	int subBucket = (int)(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	int index = (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+	return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+}
+
+/*
+ * bucketLowerBound
+ * Returns the smallest duration that falls into a bucket.
+ */
+Clock::Nanoseconds ProfileHistogram::bucketLowerBound(int index)
+{
+	if (index < SUB_BUCKETS) {
+		return index;
+	}
+
+	int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+	int subBucket = index % SUB_BUCKETS;
+	return (Clock::Nanoseconds)(SUB_BUCKETS + subBucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Profiler
+
+ProfileHistogram Profiler::histograms[PROFILE_PHASE_COUNT];
+volatile int Profiler::dumpRequested = 0;
+
+const char *Profiler::phaseNames[PROFILE_PHASE_COUNT] = {
+	"update",
+	"events",
+	"frameWait",
+	"render",
+	"renderImage",
+	"swapBuffers",
+	"upscale"
+};
+
+void Profiler::initialize()
+{
+	signal(SIGUSR1, handleSignal);
+}
+
+void Profiler::dump()
+{
+	Json::Value root;
+	for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+		ProfileHistogram &histogram = histograms[phase];
+		Json::Value &entry = root[phaseNames[phase]];
+		entry["count"] = histogram.count();
+		entry["min"] = Clock::toMilliseconds(histogram.minimum());
+		entry["p50"] = Clock::toMilliseconds(histogram.percentile(50.0));
+		entry["p99"] = Clock::toMilliseconds(histogram.percentile(99.0));
+		entry["max"] = Clock::toMilliseconds(histogram.maximum());
+	}
+
+	Json::StyledWriter writer;
+	printf("%s", writer.write(root).c_str());
+	fflush(stdout);
+}
+
+void Profiler::poll()
+{
+	if (dumpRequested) {
+		dumpRequested = 0;
+		dump();
+	}
+}
+
+void Profiler::handleSignal(int signal)
+{
+	// Only set a flag here; the dump happens on the main thread
+	dumpRequested = 1;
+}
+
+#endif
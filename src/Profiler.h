@@ -0,0 +1,127 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+/*
+ * Frame profiler
+ *
+ * Build with -DPROFILING (make PROFILE=1) to time each phase of the frame into
+ * fixed-size histograms. A summary of every phase is printed as JSON when the
+ * P key is pressed or the process receives SIGUSR1.
+ *
+ * Without PROFILING, the PROFILE_* macros expand to nothing.
+ */
+
+enum ProfilePhase {
+	PROFILE_UPDATE,        // Simulation step (simulation thread)
+	PROFILE_EVENTS,        // SDL event handling
+	PROFILE_FRAME_WAIT,    // Sleeping until the next frame deadline
+	PROFILE_RENDER,        // Render(), including skipped frames
+	PROFILE_RENDER_IMAGE,  // RenderImage()
+	PROFILE_SWAP_BUFFERS,  // SDL_GL_SwapBuffers()
+	PROFILE_UPSCALE,       // Drawing the reduced-resolution frame to the screen
+	PROFILE_PHASE_COUNT
+};
+
+#ifdef PROFILING
+
+#include "Clock.h"
+
+/*
+ * ProfileHistogram
+ * Log-linear histogram of durations, with 8 buckets per power of two.
+ * Recording never allocates. Each histogram must have a single writer thread.
+ */
+class ProfileHistogram {
+	public:
+		ProfileHistogram() { clear(); }
+
+		// Adds a duration to the histogram.
+		void record(Clock::Nanoseconds duration);
+
+		// Removes all durations from the histogram.
+		void clear();
+
+		// Returns the number of recorded durations.
+		unsigned int count() { return total; }
+
+		// Returns the smallest and largest recorded duration.
+		Clock::Nanoseconds minimum() { return total > 0 ? min : 0; }
+		Clock::Nanoseconds maximum() { return max; }
+
+		// Returns the upper bound of the bucket containing the given percentile (0..100).
+		Clock::Nanoseconds percentile(double p);
+
+	private:
+		enum {
+			SUB_BUCKET_BITS = 3,
+			SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+			BUCKET_COUNT = 256  // Up to ~17 seconds
+		};
+
+		unsigned int buckets[BUCKET_COUNT];
+		unsigned int total;
+		Clock::Nanoseconds min;
+		Clock::Nanoseconds max;
+
+		static int bucketIndex(Clock::Nanoseconds duration);
+		static Clock::Nanoseconds bucketLowerBound(int index);
+};
+
+/*
+ * Profiler
+ * Holds the histogram for each ProfilePhase.
+ */
+class Profiler {
+	public:
+		// Installs the SIGUSR1 handler.
+		static void initialize();
+
+		// Adds a duration to the histogram for a phase.
+		static void record(ProfilePhase phase, Clock::Nanoseconds duration) { histograms[phase].record(duration); }
+
+		// Prints min/p50/p99/max for every phase as JSON, in milliseconds.
+		static void dump();
+
+		// Dumps the histograms if a dump was requested by signal since the last call.
+		static void poll();
+
+	private:
+		static ProfileHistogram histograms[PROFILE_PHASE_COUNT];
+		static const char *phaseNames[PROFILE_PHASE_COUNT];
+		static volatile int dumpRequested;
+
+		static void handleSignal(int signal);
+};
+
+/*
+ * ProfileScope
+ * Records the lifetime of the object as a duration of the given phase.
+ */
+class ProfileScope {
+	public:
+		ProfileScope(ProfilePhase phase) : phase(phase), start(Clock::now()) {}
+		~ProfileScope() { Profiler::record(phase, Clock::now() - start); }
+
+	private:
+		ProfilePhase phase;
+		Clock::Nanoseconds start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define PROFILE_INITIALIZE() Profiler::initialize()
+#define PROFILE_DUMP() Profiler::dump()
+#define PROFILE_POLL() Profiler::poll()
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_INITIALIZE() ((void)0)
+#define PROFILE_DUMP() ((void)0)
+#define PROFILE_POLL() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#include "RenderTarget.h"
+
+#include <cstdio>
+
+#include "Profiler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+// Quad covering the whole viewport, as a triangle strip
+static const float QUAD_POSITIONS[] = {
+	-1.0f, -1.0f,
+	 1.0f, -1.0f,
+	-1.0f,  1.0f,
+	 1.0f,  1.0f
+};
+
+// Smallest scale allowed, so the texture never has an empty viewport
+static const float MIN_SCALE = 0.0625f;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+RenderTarget::RenderTarget(Shader *shader, int width, int height, bool deep)
+	: shader(shader), framebuffer(0), texture(0), buffer(0),
+	  type(deep ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT_5_6_5),
+	  width(width), height(height), currentScale(1.0f),
+	  scaledWidth(width), scaledHeight(height)
+{
+	textureUniform = shader->uniformHandle("Texture");
+
+	glGenBuffers(1, &buffer);
+	GLState::bindArrayBuffer(buffer);
+	glBufferData(GL_ARRAY_BUFFER, 2 * sizeof(QUAD_POSITIONS), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(QUAD_POSITIONS), QUAD_POSITIONS);
+	uploadTexCoords();
+
+	glGenTextures(1, &texture);
+	glGenFramebuffers(1, &framebuffer);
+
+	// Not every driver can render to 24-bit textures
+	bool complete = allocate();
+	if (!complete && type != GL_UNSIGNED_SHORT_5_6_5) {
+		type = GL_UNSIGNED_SHORT_5_6_5;
+		complete = allocate();
+	}
+
+	if (!complete) {
+		printf("Can't render to a texture; rendering at full resolution\n");
+		GLState::deleteFramebuffers(1, &framebuffer);
+		GLState::deleteTextures(1, &texture);
+		framebuffer = 0;
+		texture = 0;
+	}
+}
+
+RenderTarget::~RenderTarget()
+{
+	if (framebuffer != 0) {
+		GLState::deleteFramebuffers(1, &framebuffer);
+		GLState::deleteTextures(1, &texture);
+	}
+	GLState::deleteBuffers(1, &buffer);
+}
+
+void RenderTarget::resize(int width, int height)
+{
+	if (width == this->width && height == this->height) {
+		return;
+	}
+
+	this->width = width;
+	this->height = height;
+	if (framebuffer != 0 && !allocate()) {
+		printf("Can't render to a %dx%d texture; rendering at full resolution\n", width, height);
+		GLState::deleteFramebuffers(1, &framebuffer);
+		GLState::deleteTextures(1, &texture);
+		framebuffer = 0;
+		texture = 0;
+	}
+	setScale(currentScale);
+}
+
+void RenderTarget::setScale(float scale)
+{
+	if (scale < MIN_SCALE) { scale = MIN_SCALE; }
+	if (scale > 1.0f)      { scale = 1.0f; }
+
+	currentScale = scale;
+	scaledWidth  = (int)(width * scale + 0.5f);
+	scaledHeight = (int)(height * scale + 0.5f);
+	uploadTexCoords();
+}
+
+void RenderTarget::begin()
+{
+	if (active()) {
+		GLState::bindFramebuffer(framebuffer);
+		GLState::viewport(0, 0, scaledWidth, scaledHeight);
+	}
+	else {
+		GLState::bindFramebuffer(0);
+		GLState::viewport(0, 0, width, height);
+	}
+}
+
+void RenderTarget::end()
+{
+	if (!active()) {
+		return;
+	}
+
+	PROFILE_SCOPE(PROFILE_UPSCALE);
+
+	GLState::bindFramebuffer(0);
+	GLState::viewport(0, 0, width, height);
+
+	// Clearing tells tiled GPUs they needn't load the old contents of the screen
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	shader->bind();
+	GLState::bindTexture(0, texture);
+	shader->setUniform(textureUniform, 0);
+
+	GLState::bindArrayBuffer(buffer);
+	GLState::vertexAttribPointer(Shader::ATTRIB_POSITION, POSITION_SIZE, 0, 0);
+	GLState::vertexAttribPointer(Shader::ATTRIB_TEXCOORD, TEXCOORD_SIZE, 0, sizeof(QUAD_POSITIONS));
+	GLState::enableVertexAttribArray(Shader::ATTRIB_POSITION);
+	GLState::enableVertexAttribArray(Shader::ATTRIB_TEXCOORD);
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, VERTEX_COUNT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * allocate
+ * Allocates the texture at the screen size and attaches it to the framebuffer.
+ *
+ * Returns
+ *     false if the framebuffer isn't complete.
+ */
+bool RenderTarget::allocate()
+{
+	GLState::bindTexture(0, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, type, NULL);
+
+	GLState::bindFramebuffer(framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	GLState::bindFramebuffer(0);
+
+	return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+/*
+ * uploadTexCoords
+ * Computes and uploads the texture coordinates of the rendered part of the
+ * texture. They stop half a texel inside it, so filtering never blends in
+ * texels outside the viewport.
+ */
+void RenderTarget::uploadTexCoords()
+{
+	float left   = 0.5f / width;
+	float right  = (scaledWidth - 0.5f) / width;
+	float bottom = 0.5f / height;
+	float top    = (scaledHeight - 0.5f) / height;
+
+	float texCoords[VERTEX_COUNT * TEXCOORD_SIZE] = {
+		left,  bottom,
+		right, bottom,
+		left,  top,
+		right, top
+	};
+
+	GLState::bindArrayBuffer(buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(QUAD_POSITIONS), sizeof(texCoords), texCoords);
+}
@@ -0,0 +1,78 @@
+#ifndef __RENDERTARGET_H__
+#define __RENDERTARGET_H__
+
+#include <GLES2/gl2.h>
+
+#include "GLState.h"
+#include "Shader.h"
+
+/*
+ * RenderTarget
+ * Offscreen framebuffer for rendering at a fraction of the screen resolution.
+ *
+ * While the scale is below 1, frames drawn between begin() and end() go to a
+ * texture, and end() stretches it over the screen with linear filtering. At
+ * full scale, frames are drawn straight to the screen.
+ *
+ * The texture is allocated at the full screen size, so changing the scale
+ * only changes the viewport and the texture coordinates of the upscale.
+ */
+class RenderTarget {
+	public:
+		// Constructor
+		// Arguments
+		//		shader: Shader that draws the texture over the screen, with a
+		//		        Position and TexCoord attribute and a Texture sampler.
+		//		width:  Width of the screen
+		//		height: Height of the screen
+		//		deep:   Whether to render 24-bit color, rather than RGB565
+		RenderTarget(Shader *shader, int width, int height, bool deep);
+
+		// Destructor
+		~RenderTarget();
+
+		// Returns false if the driver can't render to a texture, in which
+		// case frames are always drawn straight to the screen.
+		bool usable() { return framebuffer != 0; }
+
+		// Reallocates the texture for a new screen size.
+		// Does nothing if the size hasn't changed.
+		void resize(int width, int height);
+
+		// Sets the fraction of the screen resolution to render at, from 0 to 1.
+		void setScale(float scale);
+
+		// Returns the fraction of the screen resolution being rendered at.
+		float scale() { return currentScale; }
+
+		// Directs drawing to the texture, or to the screen at full scale.
+		void begin();
+
+		// Draws the texture over the screen, if it was rendered to.
+		void end();
+
+	private:
+		enum {
+			VERTEX_COUNT = 4,
+			POSITION_SIZE = 2,  // Floats per position
+			TEXCOORD_SIZE = 2   // Floats per texture coordinate
+		};
+
+		Shader *shader;
+		Shader::Uniform textureUniform;
+
+		unsigned int framebuffer;
+		unsigned int texture;
+		unsigned int buffer;
+		GLenum type;                    // Texel type of the texture
+
+		int width, height;              // Size of the screen and the texture
+		float currentScale;
+		int scaledWidth, scaledHeight;  // Size rendered at
+
+		bool active() { return framebuffer != 0 && currentScale < 1.0f; }
+		bool allocate();
+		void uploadTexCoords();
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "ResolutionGovernor.h"
+
+#include <cstdio>
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+// Change in scale per step; the rendered area changes by about twice as much
+static const float SCALE_STEP = 0.0625f;
+
+// Loads above HIGH_LOAD step the scale down, and loads below LOW_LOAD step it
+// up. One step up raises the load by at most ~30%, so the gap keeps a step up
+// from immediately triggering a step down.
+static const float HIGH_LOAD = 0.85f;
+static const float LOW_LOAD = 0.55f;
+
+// Weight of each frame in the load average
+static const float LOAD_SMOOTHING = 0.125f;
+
+// Frames the load must stay out of range before the scale changes
+static const int FRAMES_BEFORE_DOWN = 8;
+static const int FRAMES_BEFORE_UP = 120;
+
+// Frames after a change before the load is trusted again
+static const int SETTLING_FRAMES = 30;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+ResolutionGovernor::ResolutionGovernor(float minimum, float maximum)
+	: minimum(minimum), maximum(maximum), current(maximum),
+	  load(0.0f), framesOver(0), framesUnder(0), settling(SETTLING_FRAMES)
+{
+}
+
+bool ResolutionGovernor::update(Clock::Nanoseconds frameTime, Clock::Nanoseconds period)
+{
+	if (period <= 0) {
+		return false;
+	}
+
+	load += ((float)frameTime / (float)period - load) * LOAD_SMOOTHING;
+
+	if (settling > 0) {
+		--settling;
+		return false;
+	}
+
+	framesOver  = load > HIGH_LOAD ? framesOver + 1 : 0;
+	framesUnder = load < LOW_LOAD  ? framesUnder + 1 : 0;
+
+	if (framesOver >= FRAMES_BEFORE_DOWN && current > minimum) {
+		setScale(current - SCALE_STEP);
+		return true;
+	}
+	if (framesUnder >= FRAMES_BEFORE_UP && current < maximum) {
+		setScale(current + SCALE_STEP);
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * setScale
+ * Changes the scale, clamped to the allowed range, and starts settling.
+ *
+ * Arguments
+ *     scale: The new scale.
+ */
+void ResolutionGovernor::setScale(float scale)
+{
+	if (scale < minimum) { scale = minimum; }
+	if (scale > maximum) { scale = maximum; }
+
+	printf("Render scale %.3f -> %.3f (frame load %.2f)\n", current, scale, load);
+
+	current = scale;
+	framesOver = 0;
+	framesUnder = 0;
+	settling = SETTLING_FRAMES;
+}
@@ -0,0 +1,46 @@
+#ifndef __RESOLUTIONGOVERNOR_H__
+#define __RESOLUTIONGOVERNOR_H__
+
+#include "Clock.h"
+
+/*
+ * ResolutionGovernor
+ * Picks the fraction of the screen resolution to render at from how long
+ * frames take, to hold the frame rate on devices short of fill rate.
+ *
+ * Frame times are averaged as a fraction of the display period. The scale
+ * steps down as soon as the average nears a whole period, and only steps back
+ * up after frames have had plenty of time to spare for a while. Every change
+ * is followed by a settling time, so the scale doesn't oscillate.
+ */
+class ResolutionGovernor {
+	public:
+		// Constructor
+		// Arguments
+		//		minimum: Smallest scale to render at.
+		//		maximum: Largest scale to render at, and the initial scale.
+		ResolutionGovernor(float minimum, float maximum);
+
+		// Records the time of a presented frame.
+		// Arguments
+		//		frameTime: Time from the start of the frame's work until its swap returned.
+		//		period:    Display period.
+		// Returns
+		//		true if the scale changed.
+		bool update(Clock::Nanoseconds frameTime, Clock::Nanoseconds period);
+
+		// Returns the current scale.
+		float scale() { return current; }
+
+	private:
+		float minimum, maximum;
+		float current;
+		float load;        // Average frame time, as a fraction of the display period
+		int framesOver;    // Consecutive frames with the load too high
+		int framesUnder;   // Consecutive frames with the load low enough to step up
+		int settling;      // Frames left before the scale may change again
+
+		void setScale(float scale);
+};
+
+#endif
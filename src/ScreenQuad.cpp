@@ -0,0 +1,147 @@
+#include "ScreenQuad.h"
+
+#include <vector>
+
+#include "Shader.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+// Quad covering the whole viewport, as a triangle strip
+static const float QUAD_POSITIONS[] = {
+	-1.0f, -1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	 1.0f, -1.0f, 0.0f,
+	 1.0f,  1.0f, 0.0f
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+ScreenQuad::ScreenQuad(Animation *animation, int width, int height)
+	: animation(animation), width(width), height(height)
+{
+	glGenBuffers(1, &buffer);
+	GLState::bindArrayBuffer(buffer);
+
+	// Allocate the buffer, then fill in the static positions and every frame's coordinates
+	glBufferData(GL_ARRAY_BUFFER, texCoordOffset(animation->frameCount()), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(QUAD_POSITIONS), QUAD_POSITIONS);
+	uploadTexCoords();
+}
+
+ScreenQuad::~ScreenQuad()
+{
+	GLState::deleteBuffers(1, &buffer);
+}
+
+void ScreenQuad::resize(int width, int height)
+{
+	if (width == this->width && height == this->height) {
+		return;
+	}
+
+	this->width = width;
+	this->height = height;
+	uploadTexCoords();
+}
+
+void ScreenQuad::updateFrame(int n)
+{
+	float texCoords[VERTEX_COUNT * TEXCOORD_SIZE];
+	frameTexCoords(n, texCoords);
+
+	GLState::bindArrayBuffer(buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, texCoordOffset(n), sizeof(texCoords), texCoords);
+}
+
+void ScreenQuad::draw(int n)
+{
+	GLState::bindArrayBuffer(buffer);
+	GLState::vertexAttribPointer(Shader::ATTRIB_POSITION, POSITION_SIZE, 0, 0);
+	GLState::vertexAttribPointer(Shader::ATTRIB_TEXCOORD, TEXCOORD_SIZE, 0, texCoordOffset(n));
+	GLState::enableVertexAttribArray(Shader::ATTRIB_POSITION);
+	GLState::enableVertexAttribArray(Shader::ATTRIB_TEXCOORD);
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, VERTEX_COUNT);
+}
+
+void ScreenQuad::draw(int n, int next)
+{
+	GLState::bindArrayBuffer(buffer);
+	GLState::vertexAttribPointer(Shader::ATTRIB_NEXT_TEXCOORD, TEXCOORD_SIZE, 0, texCoordOffset(next));
+	GLState::enableVertexAttribArray(Shader::ATTRIB_NEXT_TEXCOORD);
+	draw(n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * texCoordOffset
+ * Returns the byte offset of a frame's texture coordinates in the buffer.
+ */
+unsigned int ScreenQuad::texCoordOffset(int n)
+{
+	return sizeof(QUAD_POSITIONS) + n * VERTEX_COUNT * TEXCOORD_SIZE * sizeof(float);
+}
+
+/*
+ * frameTexCoords
+ * Computes the texture coordinates that crop a frame to fill the screen.
+ *
+ * Arguments
+ *     n:         Index of the frame.
+ *     texCoords: Output array for the four vertices' coordinates.
+ */
+void ScreenQuad::frameTexCoords(int n, float *texCoords)
+{
+	// Clip texture to fill screen
+	float textureAspectRatio = animation->aspectRatio(n);
+	float screenAspectRatio = ((float)height) / ((float)width);
+
+	float wMin, wMax, hMin, hMax;
+	if (textureAspectRatio > screenAspectRatio) {
+		wMin = (1.0f - (screenAspectRatio / textureAspectRatio)) / 2;
+		wMax = (1.0f + (screenAspectRatio / textureAspectRatio)) / 2;
+		hMin = 0.0f;
+		hMax = 1.0f;
+	}
+	else {
+		wMin = 0.0f;
+		wMax = 1.0f;
+		hMin = (1.0f - (textureAspectRatio / screenAspectRatio)) / 2;
+		hMax = (1.0f + (textureAspectRatio / screenAspectRatio)) / 2;
+	}
+
+	// Map into the frame's rectangle of its texture
+	float left   = animation->frameXCoord(n);
+	float top    = animation->frameYCoord(n);
+	float wSize  = animation->frameWCoord(n) - left;
+	float hSize  = animation->frameHCoord(n) - top;
+	wMin = left + wMin * wSize;
+	wMax = left + wMax * wSize;
+	hMin = top + hMin * hSize;
+	hMax = top + hMax * hSize;
+
+	texCoords[0] = wMax; texCoords[1] = hMin;
+	texCoords[2] = wMin; texCoords[3] = hMin;
+	texCoords[4] = wMax; texCoords[5] = hMax;
+	texCoords[6] = wMin; texCoords[7] = hMax;
+}
+
+/*
+ * uploadTexCoords
+ * Computes and uploads the texture coordinates for every frame.
+ */
+void ScreenQuad::uploadTexCoords()
+{
+	int count = animation->frameCount();
+	std::vector<float> texCoords(count * VERTEX_COUNT * TEXCOORD_SIZE);
+	for (int n = 0; n < count; ++n) {
+		frameTexCoords(n, &texCoords[n * VERTEX_COUNT * TEXCOORD_SIZE]);
+	}
+
+	GLState::bindArrayBuffer(buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, texCoordOffset(0), texCoords.size() * sizeof(float), &texCoords[0]);
+}
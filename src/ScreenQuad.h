@@ -0,0 +1,62 @@
+#ifndef __SCREENQUAD_H__
+#define __SCREENQUAD_H__
+
+#include <GLES2/gl2.h>
+
+#include "Animation.h"
+#include "GLState.h"
+
+/*
+ * ScreenQuad
+ * Full-screen quad geometry for drawing animation frames, kept in a static
+ * vertex buffer.
+ *
+ * The buffer holds the quad positions followed by the texture coordinates for
+ * every frame, cropped to fill the screen. Switching frames only changes the
+ * offset of the texture coordinate attribute; nothing is uploaded per draw.
+ */
+class ScreenQuad {
+	public:
+		// Constructor
+		// Arguments
+		//		animation: The Animation whose frames will be drawn
+		//		width:     Width of the screen
+		//		height:    Height of the screen
+		ScreenQuad(Animation *animation, int width, int height);
+
+		// Destructor
+		~ScreenQuad();
+
+		// Recomputes the texture coordinates for a new screen size.
+		// Does nothing if the size hasn't changed.
+		void resize(int width, int height);
+
+		// Recomputes the texture coordinates for a single frame, e.g. after it was reloaded.
+		void updateFrame(int n);
+
+		// Draws the quad with the texture coordinates for the given frame.
+		// The shader and the frame's texture must be bound.
+		void draw(int n);
+
+		// Draws the quad with the texture coordinates for two frames being
+		// crossfaded, the second in the NextTexCoord attribute.
+		// The shader and both frames' textures must be bound.
+		void draw(int n, int next);
+
+	private:
+		enum {
+			VERTEX_COUNT = 4,
+			POSITION_SIZE = 3,  // Floats per position
+			TEXCOORD_SIZE = 2   // Floats per texture coordinate
+		};
+
+		Animation *animation;
+		int width, height;
+		unsigned int buffer;
+
+		static unsigned int texCoordOffset(int n);
+		void frameTexCoords(int n, float *texCoords);
+		void uploadTexCoords();
+};
+
+#endif
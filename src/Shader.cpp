@@ -1,19 +1,56 @@
 #include "Shader.h"
 
+#include <cstring>
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public methods
 
 Shader::~Shader()
 {
-	glDetachShader(shaderId, vertexShader);
-	glDetachShader(shaderId, fragmentShader);
+	if (vertexShader != 0) {
+		glDetachShader(shaderId, vertexShader);
+		glDetachShader(shaderId, fragmentShader);
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+	}
 
 	glDeleteProgram(shaderId);
 }
 
+int Shader::uniform(const char *name)
+{
+	int index = findVariable(uniforms, name);
+	return index < 0 ? -1 : uniforms[index].location;
+}
+
+int Shader::attribute(const char *name)
+{
+	int index = findVariable(attributes, name);
+	return index < 0 ? -1 : attributes[index].location;
+}
+
+void Shader::setUniform(Uniform handle, int value)
+{
+	if (cacheUniform(handle, &value, sizeof(value))) {
+		glUniform1i(uniforms[handle].location, value);
+	}
+}
+
+void Shader::setUniform(Uniform handle, float value)
+{
+	if (cacheUniform(handle, &value, sizeof(value))) {
+		glUniform1f(uniforms[handle].location, value);
+	}
+}
+
+void Shader::setUniformMatrix4(Uniform handle, const float *matrix)
+{
+	if (cacheUniform(handle, matrix, 16 * sizeof(float))) {
+		glUniformMatrix4fv(uniforms[handle].location, 1, GL_FALSE, matrix);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Private methods
 
@@ -22,20 +59,20 @@ Shader::~Shader()
  * Compiles a GLSL shader.
  *
  * Arguments
- *     filename: Filename of the shader source file.
+ *     filename: Filename of the shader source file, for error messages.
+ *     source:   Contents of the shader source file.
  *     id:       Handle of the shader object.
+ *     preamble: Source inserted before the file's.
  *
  * Throws
- *     FileOpenException
  *     GLSLCompilationException
  */
-void Shader::compileShader(std::string const& filename, int id)
+void Shader::compileShader(std::string const& filename, std::string const& source, int id, std::string const& preamble)
 {
-    std::string source = FileIO::loadTextFile(filename);
-	const char *glSource = source.c_str();
+	const char *glSources[2] = { preamble.c_str(), source.c_str() };
 
     // Compile the shader code
-    glShaderSource  (id, 1, &glSource, NULL); 
+    glShaderSource  (id, 2, glSources, NULL); 
     glCompileShader (id);
 
     // Validate compilation
@@ -50,11 +87,14 @@ void Shader::compileShader(std::string const& filename, int id)
 
 /*
  * init
- * Initializes the Shader.
+ * Initializes the Shader, from the cache if it holds the program.
  *
  * Arguments
  *     vsFilename: Filename of the vertex shader source file.
  *     fsFilename: Filename of the fragment shader source file.
+ *     vsPreamble: Source inserted before the vertex shader's.
+ *     fsPreamble: Source inserted before the fragment shader's.
+ *     cache:      Cache of linked programs, or NULL.
  *
  * Throws
  *     FileOpenException
@@ -62,25 +102,89 @@ void Shader::compileShader(std::string const& filename, int id)
  *     GLSLLinkingException
  *     GLSLValidationException
  */
-void Shader::init(std::string vsFilename, std::string fsFilename)
+void Shader::init(std::string vsFilename, std::string fsFilename,
+		std::string const& vsPreamble, std::string const& fsPreamble, ShaderCache *cache)
+{
+	std::string vsSource = FileIO::loadTextFile(vsFilename);
+	std::string fsSource = FileIO::loadTextFile(fsFilename);
+
+	shaderId = glCreateProgram();
+	vertexShader = 0;
+	fragmentShader = 0;
+
+	// A binary from the cache is already linked, with the attribute locations bound
+	Hash::Value key = 0;
+	bool cached = false;
+	if (cache != NULL) {
+		key = cache->key(vsPreamble + vsSource, fsPreamble + fsSource);
+		cached = cache->load(key, shaderId);
+	}
+
+	if (!cached) {
+		link(vsFilename, vsSource, vsPreamble, fsFilename, fsSource, fsPreamble);
+		if (cache != NULL) {
+			cache->store(key, shaderId);
+		}
+	}
+
+	// Look up the active uniforms and attributes
+	reflect();
+
+#ifdef DEBUG
+	// Validate program
+	int shaderStatus;
+    glValidateProgram(shaderId);
+    glGetProgramiv(shaderId, GL_VALIDATE_STATUS, &shaderStatus); 
+    if (shaderStatus != GL_TRUE) {
+        char errorMessage[1024];
+        glGetProgramInfoLog(shaderId, 1024, NULL, errorMessage);
+		throw GLSLValidationException(errorMessage);
+    }
+#endif
+
+    // Enable vertex attribute arrays
+    GLState::enableVertexAttribArray(ATTRIB_POSITION);
+    GLState::enableVertexAttribArray(ATTRIB_TEXCOORD);
+    if (attribute("NextTexCoord") >= 0) {
+        GLState::enableVertexAttribArray(ATTRIB_NEXT_TEXCOORD);
+    }
+}
+
+/*
+ * link
+ * Compiles the shaders and links them into the program.
+ *
+ * Arguments
+ *     vsFilename: Filename of the vertex shader source file.
+ *     vsSource:   Contents of the vertex shader source file.
+ *     vsPreamble: Source inserted before the vertex shader's.
+ *     fsFilename: Filename of the fragment shader source file.
+ *     fsSource:   Contents of the fragment shader source file.
+ *     fsPreamble: Source inserted before the fragment shader's.
+ *
+ * Throws
+ *     GLSLCompilationException
+ *     GLSLLinkingException
+ */
+void Shader::link(std::string const& vsFilename, std::string const& vsSource, std::string const& vsPreamble,
+		std::string const& fsFilename, std::string const& fsSource, std::string const& fsPreamble)
 {
     // Create shader objects
     vertexShader   = glCreateShader(GL_VERTEX_SHADER);
     fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
 	// Compile the shaders
-    compileShader(vsFilename, vertexShader);
-    compileShader(fsFilename, fragmentShader);
-
-    // Create the program and attach the shaders & attributes
-    shaderId = glCreateProgram();
+    compileShader(vsFilename, vsSource, vertexShader, vsPreamble);
+    compileShader(fsFilename, fsSource, fragmentShader, fsPreamble);
 
+    // Attach the shaders & attributes
     glAttachShader(shaderId, vertexShader);
     glAttachShader(shaderId, fragmentShader);
 
 	// Bind vertex attribute locations
-    glBindAttribLocation(shaderId, ATTRIB_POSITION, "a_Position");
-    glBindAttribLocation(shaderId, ATTRIB_TEXCOORD, "a_TexCoord");
+    glBindAttribLocation(shaderId, ATTRIB_POSITION, "Position");
+    glBindAttribLocation(shaderId, ATTRIB_TEXCOORD, "TexCoord");
+    glBindAttribLocation(shaderId, ATTRIB_NEXT_TEXCOORD, "NextTexCoord");
 
     // Link the program
     glLinkProgram(shaderId);
@@ -93,17 +197,144 @@ void Shader::init(std::string vsFilename, std::string fsFilename)
         glGetProgramInfoLog(shaderId, 1024, NULL, errorMessage);
 		throw GLSLLinkingException(errorMessage);
     }
+}
 
-	// Validate program
-    glValidateProgram(shaderId);
-    glGetProgramiv(shaderId, GL_VALIDATE_STATUS, &shaderStatus); 
-    if (shaderStatus != GL_TRUE) {
-        char errorMessage[1024];
-        glGetProgramInfoLog(shaderId, 1024, NULL, errorMessage);
-		throw GLSLValidationException(errorMessage);
-    }
+/*
+ * reflect
+ * Fills the uniform and attribute tables from the linked program.
+ *
+ * Throws
+ *     GLSLLinkingException
+ */
+void Shader::reflect()
+{
+	for (int i = 0; i < TABLE_SIZE; ++i) {
+		uniforms[i].name[0] = '\0';
+		uniforms[i].location = -1;
+		attributes[i].name[0] = '\0';
+		attributes[i].location = -1;
+	}
 
-    // Enable vertex attribute arrays
-    glEnableVertexAttribArray(ATTRIB_POSITION);
-    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+	char name[MAX_NAME_LENGTH];
+	int count, size;
+	GLenum type;
+
+	glGetProgramiv(shaderId, GL_ACTIVE_UNIFORMS, &count);
+	for (int i = 0; i < count; ++i) {
+		glGetActiveUniform(shaderId, i, MAX_NAME_LENGTH, NULL, &size, &type, name);
+
+		// Arrays are reported as "name[0]"
+		char *bracket = strchr(name, '[');
+		if (bracket != NULL) {
+			*bracket = '\0';
+		}
+
+		Variable *variable = insertVariable(uniforms, name);
+		variable->location = glGetUniformLocation(shaderId, name);
+		variable->type = type;
+		variable->size = size;
+		variable->hasValue = false;
+	}
+
+	glGetProgramiv(shaderId, GL_ACTIVE_ATTRIBUTES, &count);
+	for (int i = 0; i < count; ++i) {
+		glGetActiveAttrib(shaderId, i, MAX_NAME_LENGTH, NULL, &size, &type, name);
+
+		Variable *variable = insertVariable(attributes, name);
+		variable->location = glGetAttribLocation(shaderId, name);
+		variable->type = type;
+		variable->size = size;
+		variable->hasValue = false;
+	}
+}
+
+/*
+ * cacheUniform
+ * Stores a uniform value in the uniform table.
+ *
+ * Arguments
+ *     handle: Handle of the uniform.
+ *     value:  New contents of the uniform.
+ *     size:   Size of the value in bytes, at most 16 floats.
+ *
+ * Returns
+ *     true if the value differs from the uniform's current contents, and
+ *     needs to be passed to GL.
+ */
+bool Shader::cacheUniform(Uniform handle, const void *value, size_t size)
+{
+	if (handle == INVALID_UNIFORM) {
+		return false;
+	}
+
+	Variable &variable = uniforms[handle];
+	if (variable.hasValue && memcmp(variable.value, value, size) == 0) {
+		return false;
+	}
+
+	memcpy(variable.value, value, size);
+	variable.hasValue = true;
+	return true;
+}
+
+/*
+ * hashName
+ * Returns the 32-bit FNV-1a hash of a variable name.
+ */
+unsigned int Shader::hashName(const char *name)
+{
+	unsigned int hash = 2166136261u;
+	for (; *name != '\0'; ++name) {
+		hash ^= (unsigned char)*name;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*
+ * findVariable
+ * Looks up a variable by name in a uniform or attribute table.
+ *
+ * Returns
+ *     The index of the variable, or INVALID_UNIFORM if it isn't in the table.
+ */
+int Shader::findVariable(Variable *table, const char *name)
+{
+	unsigned int hash = hashName(name);
+	for (int probe = 0; probe < TABLE_SIZE; ++probe) {
+		int index = (hash + probe) & (TABLE_SIZE - 1);
+		Variable &variable = table[index];
+		if (variable.name[0] == '\0') {
+			break;
+		}
+		if (variable.hash == hash && strcmp(variable.name, name) == 0) {
+			return index;
+		}
+	}
+	return INVALID_UNIFORM;
+}
+
+/*
+ * insertVariable
+ * Adds a variable to a uniform or attribute table.
+ *
+ * Returns
+ *     The new table entry, with its name and hash filled in.
+ *
+ * Throws
+ *     GLSLLinkingException
+ */
+Shader::Variable *Shader::insertVariable(Variable *table, const char *name)
+{
+	unsigned int hash = hashName(name);
+	for (int probe = 0; probe < TABLE_SIZE; ++probe) {
+		Variable &variable = table[(hash + probe) & (TABLE_SIZE - 1)];
+		if (variable.name[0] == '\0') {
+			strncpy(variable.name, name, MAX_NAME_LENGTH - 1);
+			variable.name[MAX_NAME_LENGTH - 1] = '\0';
+			variable.hash = hash;
+			return &variable;
+		}
+	}
+	throw GLSLLinkingException("Too many active variables");
 }
@@ -9,48 +9,109 @@
 
 #include "Exceptions.h"
 #include "FileIO.h"
+#include "GLState.h"
+#include "ShaderCache.h"
 
 /*
  * Shader
  * Represents a GLSL shader program.
+ *
+ * The active uniforms and attributes are enumerated once at link time, so
+ * lookups by name don't go to the driver. With a ShaderCache, a program
+ * linked on an earlier launch is loaded as a driver binary instead of being
+ * compiled. Uniforms are set through handles,
+ * and a setter skips the GL call when the uniform already holds the value.
  */
 class Shader {
 	public:
+		// Handle for a uniform, or INVALID_UNIFORM if the uniform isn't active.
+		typedef int Uniform;
+		enum { INVALID_UNIFORM = -1 };
+
 		// Constructor
 		// Arguments
-		//		vsFilename: Filename for a GLSL vertex shader
-		//		fsFilename: Filename for a GLSL fragment shader
-		Shader(std::string vsFilename, std::string fsFilename) { init(vsFilename, fsFilename); }
+		//		vsFilename:       Filename for a GLSL vertex shader
+		//		fsFilename:       Filename for a GLSL fragment shader
+		//		preamble:         Source inserted before both shaders, e.g. #defines
+		//		fragmentPreamble: Source inserted before the fragment shader only,
+		//		                  after the shared preamble, e.g. a default precision
+		//		cache:            Cache of linked programs, or NULL to always compile
+		Shader(std::string vsFilename, std::string fsFilename, std::string const& preamble = "",
+				std::string const& fragmentPreamble = "", ShaderCache *cache = NULL)
+		{
+			init(vsFilename, fsFilename, preamble, preamble + fragmentPreamble, cache);
+		}
 
 		// Destructor
 		~Shader();
 
 		// Binds this shader to the GL context.
-		void bind() { glUseProgram(shaderId); }
+		void bind() { GLState::useProgram(shaderId); }
 
 		// Unbinds this shader from the GL context.
-		void unbind() { glUseProgram(0); }
+		void unbind() { GLState::useProgram(0); }
 
 		// Returns the handle for the shader program.
 		unsigned int id() { return shaderId; }
 
-		// Returns the handle for a shader uniform
-		int uniform(const char *name) { return glGetUniformLocation(shaderId, name); }
+		// Returns the location of a shader uniform, or -1 if it isn't active.
+		int uniform(const char *name);
+
+		// Returns the location of a shader attribute, or -1 if it isn't active.
+		int attribute(const char *name);
+
+		// Returns the handle for a shader uniform, for use with the setters.
+		Uniform uniformHandle(const char *name) { return findVariable(uniforms, name); }
+
+		// Uniform setters. The shader must be bound.
+		void setUniform(Uniform handle, int value);
+		void setUniform(Uniform handle, float value);
+		void setUniformMatrix4(Uniform handle, const float *matrix);
 
 		enum {
 			// Handle for the position attribute
 			ATTRIB_POSITION,
 			// Handle for the texture coordinate attribute
-			ATTRIB_TEXCOORD
+			ATTRIB_TEXCOORD,
+			// Handle for the texture coordinate attribute of the next frame, when crossfading
+			ATTRIB_NEXT_TEXCOORD
 		};
 
 	private:
+		enum {
+			TABLE_SIZE = 32,      // Capacity of each variable table; a power of 2
+			MAX_NAME_LENGTH = 64
+		};
+
+		// An active uniform or attribute
+		struct Variable {
+			char name[MAX_NAME_LENGTH];  // Empty for an empty slot
+			unsigned int hash;
+			int location;         // -1 for an empty slot
+			GLenum type;
+			int size;
+			bool hasValue;        // Whether value holds the uniform's current contents
+			float value[16];
+		};
+
         unsigned int shaderId;          // The handle for the shader program
-		unsigned int vertexShader;      // The handle for the vertex shader
-		unsigned int fragmentShader;    // The handle for the fragment shader
+		unsigned int vertexShader;      // The handle for the vertex shader, or 0 if loaded from a binary
+		unsigned int fragmentShader;    // The handle for the fragment shader, or 0 if loaded from a binary
+
+		Variable uniforms[TABLE_SIZE];
+		Variable attributes[TABLE_SIZE];
+
+		static void compileShader(std::string const& filename, std::string const& source, int id, std::string const& preamble);
+		void init(std::string vsFilename, std::string fsFilename,
+				std::string const& vsPreamble, std::string const& fsPreamble, ShaderCache *cache);
+		void link(std::string const& vsFilename, std::string const& vsSource, std::string const& vsPreamble,
+				std::string const& fsFilename, std::string const& fsSource, std::string const& fsPreamble);
+		void reflect();
+		bool cacheUniform(Uniform handle, const void *value, size_t size);
 
-		static void compileShader(std::string const& filename, int id);
-		void init(std::string vsFilename, std::string fsFilename);
+		static unsigned int hashName(const char *name);
+		static int findVariable(Variable *table, const char *name);
+		static Variable *insertVariable(Variable *table, const char *name);
 };
 
 #endif
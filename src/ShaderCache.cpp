@@ -0,0 +1,149 @@
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#include "SDL.h"
+
+#include "FileIO.h"
+#include "GLInfo.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+ShaderCache::ShaderCache(std::string const& directory)
+	: directory(directory), usable(false), loaded(0), driverHash(Hash::OFFSET_BASIS),
+	  getProgramBinary(NULL), programBinary(NULL)
+{
+	if (directory.empty() || !GLInfo::hasExtension("GL_OES_get_program_binary")) {
+		return;
+	}
+
+	// The extension's entry points aren't exported by the GLES library
+	getProgramBinary = (PFNGLGETPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glGetProgramBinaryOES");
+	programBinary = (PFNGLPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glProgramBinaryOES");
+
+	// A driver may advertise the extension yet have no binary formats
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+	if (getProgramBinary == NULL || programBinary == NULL || formats <= 0) {
+		return;
+	}
+
+	if (!FileIO::createDirectories(directory)) {
+		printf("Can't create shader cache directory %s\n", directory.c_str());
+		return;
+	}
+
+	const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); ++i) {
+		const char *text = (const char *)glGetString(strings[i]);
+		driverHash = Hash::fnv1a(std::string(text != NULL ? text : ""), driverHash);
+		driverHash = Hash::fnv1a("\n", 1, driverHash);
+	}
+	usable = true;
+}
+
+Hash::Value ShaderCache::key(std::string const& vertexSource, std::string const& fragmentSource)
+{
+	// Hash the lengths too, so text moving between the sources changes the key
+	Hash::Value key = Hash::fnv1a((long long)VERSION, driverHash);
+	key = Hash::fnv1a((long long)vertexSource.size(), key);
+	key = Hash::fnv1a(vertexSource, key);
+	key = Hash::fnv1a((long long)fragmentSource.size(), key);
+	key = Hash::fnv1a(fragmentSource, key);
+	return key;
+}
+
+bool ShaderCache::load(Hash::Value key, unsigned int program)
+{
+	if (!usable) {
+		return false;
+	}
+
+	std::vector<unsigned char> data;
+	if (!FileIO::loadBinaryFile(entryFilename(key), data) || data.size() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, &data[0], sizeof(header));
+	if (memcmp(header.magic, "SAPB", 4) != 0 || header.version != VERSION
+		|| header.key != key || data.size() != sizeof(Header) + header.length)
+	{
+		return false;
+	}
+
+	programBinary(program, header.format, &data[sizeof(Header)], header.length);
+
+	int status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		return false;
+	}
+
+	++loaded;
+	return true;
+}
+
+void ShaderCache::store(Hash::Value key, unsigned int program)
+{
+	if (!usable) {
+		return;
+	}
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	std::vector<unsigned char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	getProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0) {
+		return;
+	}
+
+	memcpy(header.magic, "SAPB", 4);
+	header.version = VERSION;
+	header.key = key;
+	header.format = format;
+	header.length = written;
+
+	// Write to a temporary file and rename it into place, so an interrupted
+	// write never leaves a broken entry
+	std::string entry = entryFilename(key);
+	std::string temporary = entry + ".tmp";
+
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		return;
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&binary[0], 1, written, file) == (size_t)written;
+	success = fclose(file) == 0 && success;
+
+	if (!success || rename(temporary.c_str(), entry.c_str()) != 0) {
+		printf("Can't write shader cache entry %s\n", entry.c_str());
+		unlink(temporary.c_str());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * entryFilename
+ * Returns the filename of the entry for a program, named by its key.
+ */
+std::string ShaderCache::entryFilename(Hash::Value key)
+{
+	return directory + "/" + Hash::toHex(key) + ".bin";
+}
@@ -0,0 +1,77 @@
+#ifndef __SHADERCACHE_H__
+#define __SHADERCACHE_H__
+
+#include <string>
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include "Hash.h"
+
+/*
+ * ShaderCache
+ * Keeps linked shader programs on disk as driver binaries, through
+ * GL_OES_get_program_binary, so later launches can skip compiling GLSL.
+ *
+ * Each entry is keyed by the program's sources and the GL vendor, renderer
+ * and version strings, so a driver update misses the cache rather than
+ * loading a binary built for another driver. A binary the driver still
+ * rejects is treated as a miss, and the program is compiled as usual.
+ */
+class ShaderCache {
+	public:
+		// Constructor
+		// Arguments
+		//		directory: Directory holding the entries, created if necessary.
+		ShaderCache(std::string const& directory);
+
+		// Returns the key for a program built from the given sources.
+		// Arguments
+		//		vertexSource:   Complete source of the vertex shader, including any preamble.
+		//		fragmentSource: Complete source of the fragment shader, including any preamble.
+		Hash::Value key(std::string const& vertexSource, std::string const& fragmentSource);
+
+		// Loads a cached binary into a program object.
+		// Arguments
+		//		key:     Key of the program.
+		//		program: Handle of a program object with nothing attached.
+		// Returns
+		//		false if there is no entry, or the driver rejected it.
+		bool load(Hash::Value key, unsigned int program);
+
+		// Writes the binary of a linked program to the cache.
+		// Arguments
+		//		key:     Key of the program.
+		//		program: Handle of the linked program.
+		void store(Hash::Value key, unsigned int program);
+
+		// Returns the number of programs loaded from the cache.
+		int hits() { return loaded; }
+
+	private:
+		enum {
+			VERSION = 1
+		};
+
+		// Header at the start of every entry, followed by the binary
+		struct Header {
+			char magic[4];                // "SAPB"
+			unsigned int version;
+			Hash::Value key;
+			unsigned int format;          // Binary format reported by the driver
+			unsigned int length;          // Bytes of binary
+		};
+
+		std::string directory;
+		bool usable;
+		int loaded;
+
+		Hash::Value driverHash;       // Hash of the GL vendor, renderer and version
+
+		PFNGLGETPROGRAMBINARYOESPROC getProgramBinary;
+		PFNGLPROGRAMBINARYOESPROC programBinary;
+
+		std::string entryFilename(Hash::Value key);
+};
+
+#endif
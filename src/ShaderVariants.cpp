@@ -0,0 +1,92 @@
+#include "ShaderVariants.h"
+
+#include <set>
+#include <sstream>
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+static const char *PRECISION_NAMES[] = { "lowp", "mediump", "highp" };
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+ShaderVariants::ShaderVariants(std::string const& vsFilename, std::string const& fsFilename, ShaderCache *cache)
+	: vsFilename(vsFilename), fsFilename(fsFilename), cache(cache)
+{
+}
+
+ShaderVariants::~ShaderVariants()
+{
+	for (std::map<std::string, Shader *>::iterator it = variants.begin(); it != variants.end(); ++it) {
+		delete it->second;
+	}
+}
+
+Shader *ShaderVariants::get(std::string const& defines, Precision precision)
+{
+	if (precision == PRECISION_HIGH && !supportsHighPrecision()) {
+		precision = PRECISION_MEDIUM;
+	}
+
+	std::string preamble = definePreamble(defines);
+	std::string fragmentPreamble = std::string("precision ") + PRECISION_NAMES[precision] + " float;\n";
+
+	// The vertex shader keeps its own default of highp
+	std::string key = preamble + fragmentPreamble;
+	std::map<std::string, Shader *>::iterator found = variants.find(key);
+	if (found != variants.end()) {
+		return found->second;
+	}
+
+	Shader *shader = new Shader(vsFilename, fsFilename, preamble, fragmentPreamble, cache);
+	variants[key] = shader;
+	return shader;
+}
+
+ShaderVariants::Precision ShaderVariants::parsePrecision(std::string const& name, Precision fallback)
+{
+	for (int precision = PRECISION_LOW; precision <= PRECISION_HIGH; ++precision) {
+		if (name == PRECISION_NAMES[precision]) {
+			return (Precision)precision;
+		}
+	}
+	return fallback;
+}
+
+bool ShaderVariants::supportsHighPrecision()
+{
+	// Unsupported precisions report a range and precision of zero
+	int range[2] = { 0, 0 };
+	int precision = 0;
+	glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+	return range[0] != 0 || range[1] != 0 || precision != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * definePreamble
+ * Builds the #define lines for a list of names. The names are sorted and
+ * duplicates dropped, so every spelling of a set of names gives the same
+ * preamble, and the same variant.
+ *
+ * Arguments
+ *     defines: Names separated by spaces.
+ */
+std::string ShaderVariants::definePreamble(std::string const& defines)
+{
+	std::set<std::string> names;
+	std::istringstream stream(defines);
+	std::string name;
+	while (stream >> name) {
+		names.insert(name);
+	}
+
+	std::string preamble;
+	for (std::set<std::string>::iterator it = names.begin(); it != names.end(); ++it) {
+		preamble += "#define " + *it + "\n";
+	}
+	return preamble;
+}
@@ -0,0 +1,71 @@
+#ifndef __SHADERVARIANTS_H__
+#define __SHADERVARIANTS_H__
+
+#include <map>
+#include <string>
+
+#include "Shader.h"
+#include "ShaderCache.h"
+
+/*
+ * ShaderVariants
+ * Builds variants of one pair of shader sources, each with its own set of
+ * #defines and default float precision for the fragment shader.
+ *
+ * A variant is only compiled the first time it's asked for, and is kept
+ * under the preambles that produced it, so asking again returns the same
+ * Shader. The sources declare their feature switches with #ifdef, and leave
+ * the precision of fragment floats to the variant.
+ */
+class ShaderVariants {
+	public:
+		// Default precision of floats in the fragment shader
+		enum Precision {
+			PRECISION_LOW,
+			PRECISION_MEDIUM,
+			PRECISION_HIGH
+		};
+
+		// Constructor
+		// Arguments
+		//		vsFilename: Filename for a GLSL vertex shader
+		//		fsFilename: Filename for a GLSL fragment shader
+		//		cache:      Cache of linked programs, or NULL to always compile
+		ShaderVariants(std::string const& vsFilename, std::string const& fsFilename, ShaderCache *cache = NULL);
+
+		// Destructor
+		// Deletes every variant built.
+		~ShaderVariants();
+
+		// Returns a variant, compiling it if it hasn't been built yet.
+		// Arguments
+		//		defines:   Names to #define, separated by spaces, in any order.
+		//		precision: Default precision of fragment floats. High precision
+		//		           falls back to medium where fragment shaders lack it.
+		// Throws
+		//		GLSLCompilationException
+		//		GLSLLinkingException
+		Shader *get(std::string const& defines, Precision precision);
+
+		// Returns the number of variants built.
+		int count() { return (int)variants.size(); }
+
+		// Parses a precision name: "lowp", "mediump" or "highp".
+		// Returns
+		//		fallback if the name isn't one of them.
+		static Precision parsePrecision(std::string const& name, Precision fallback);
+
+		// Returns true if fragment shaders support high precision floats.
+		static bool supportsHighPrecision();
+
+	private:
+		std::string vsFilename;
+		std::string fsFilename;
+		ShaderCache *cache;
+
+		std::map<std::string, Shader *> variants;  // Keyed by the preambles
+
+		static std::string definePreamble(std::string const& defines);
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// Orders rectangle indices by decreasing height, which keeps shelves tight
+struct TallerRect {
+	std::vector<TextureAtlas::Rect> const& rects;
+	TallerRect(std::vector<TextureAtlas::Rect> const& rects) : rects(rects) {}
+	bool operator()(int a, int b) const { return rects[a].height > rects[b].height; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+TextureAtlas::TextureAtlas(int maxSize, bool powerOfTwo)
+	: maxSize(maxSize), powerOfTwo(powerOfTwo)
+{
+}
+
+int TextureAtlas::add(int width, int height)
+{
+	Rect rect;
+	rect.page = -1;
+	rect.x = 0;
+	rect.y = 0;
+	rect.width = width;
+	rect.height = height;
+	rects.push_back(rect);
+	return rects.size() - 1;
+}
+
+bool TextureAtlas::pack()
+{
+	int widest = 0;
+	for (size_t i = 0; i < rects.size(); ++i) {
+		if (rects[i].width > maxSize || rects[i].height > maxSize) {
+			return false;
+		}
+		widest = std::max(widest, rects[i].width);
+	}
+
+	// Candidate page widths: powers of two, or multiples of the widest rectangle
+	std::vector<int> pageWidths;
+	if (powerOfTwo) {
+		for (int width = nextPowerOfTwo(widest); width <= maxSize; width <<= 1) {
+			pageWidths.push_back(width);
+		}
+	}
+	else if (widest > 0) {
+		for (int width = widest; width <= maxSize; width += widest) {
+			pageWidths.push_back(width);
+		}
+	}
+
+	// Keep the layout with the least area, then the fewest pages
+	long long bestArea = -1;
+	std::vector<Rect> bestRects;
+	std::vector<Page> bestPages;
+	for (size_t i = 0; i < pageWidths.size(); ++i) {
+		int pageWidth = pageWidths[i];
+		std::vector<Rect> candidateRects = rects;
+		std::vector<Page> candidatePages;
+		long long area = packShelves(pageWidth, candidateRects, candidatePages);
+
+		if (bestArea < 0 || area < bestArea
+			|| (area == bestArea && candidatePages.size() < bestPages.size()))
+		{
+			bestArea = area;
+			bestRects.swap(candidateRects);
+			bestPages.swap(candidatePages);
+		}
+	}
+
+	rects.swap(bestRects);
+	pages.swap(bestPages);
+	return true;
+}
+
+int TextureAtlas::nextPowerOfTwo(int n)
+{
+	int result = 1;
+	while (result < n) {
+		result <<= 1;
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * packShelves
+ * Packs the rectangles onto shelves in pages of a fixed width, tallest first.
+ *
+ * Arguments
+ *     pageWidth: Width of every page.
+ *     rects:     The rectangles to place; receives their placements.
+ *     pages:     Receives the sizes of the pages used.
+ *
+ * Returns
+ *     The total area of all pages.
+ */
+long long TextureAtlas::packShelves(int pageWidth, std::vector<Rect> &rects, std::vector<Page> &pages)
+{
+	std::vector<int> order(rects.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), TallerRect(rects));
+
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	int usedWidth = 0;
+	for (size_t i = 0; i < order.size(); ++i) {
+		Rect &rect = rects[order[i]];
+
+		// Start a new shelf when this one is full
+		if (shelfX + rect.width > pageWidth) {
+			shelfY += shelfHeight;
+			shelfX = 0;
+			shelfHeight = 0;
+		}
+
+		// Start a new page when there's no room for another shelf
+		if (pages.empty() || shelfY + rect.height > maxSize) {
+			Page page;
+			page.width = 0;
+			page.height = 0;
+			pages.push_back(page);
+			shelfX = 0;
+			shelfY = 0;
+			shelfHeight = 0;
+			usedWidth = 0;
+		}
+
+		rect.page = pages.size() - 1;
+		rect.x = shelfX;
+		rect.y = shelfY;
+
+		shelfX += rect.width;
+		shelfHeight = std::max(shelfHeight, rect.height);
+		usedWidth = std::max(usedWidth, shelfX);
+
+		Page &page = pages.back();
+		page.width = usedWidth;
+		page.height = shelfY + shelfHeight;
+	}
+
+	long long area = 0;
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (powerOfTwo) {
+			pages[i].width = nextPowerOfTwo(pages[i].width);
+			pages[i].height = nextPowerOfTwo(pages[i].height);
+		}
+		area += (long long)pages[i].width * pages[i].height;
+	}
+	return area;
+}
@@ -0,0 +1,62 @@
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+#include <vector>
+
+/*
+ * TextureAtlas
+ * Packs rectangles into as few texture pages as possible, using shelf packing.
+ *
+ * Several page widths up to the maximum texture size are tried, and the
+ * layout with the least total page area wins.
+ */
+class TextureAtlas {
+	public:
+		// Placement of a rectangle in the atlas
+		struct Rect {
+			int page;
+			int x, y;
+			int width, height;
+		};
+
+		// Size of a page in the atlas
+		struct Page {
+			int width, height;
+		};
+
+		// Constructor
+		// Arguments
+		//		maxSize:    Maximum width and height of a page
+		//		powerOfTwo: Whether pages must have power-of-two sizes
+		TextureAtlas(int maxSize, bool powerOfTwo = true);
+
+		// Adds a rectangle to be packed.
+		// Returns the index of the rectangle.
+		int add(int width, int height);
+
+		// Packs the rectangles added so far.
+		// Returns false if a rectangle is larger than a page.
+		bool pack();
+
+		// Returns the placement of a rectangle after packing.
+		Rect const& rect(int index) { return rects[index]; }
+
+		// Returns the number of pages after packing.
+		int pageCount() { return pages.size(); }
+
+		// Returns the size of a page after packing, rounded up to a power of two if required.
+		Page const& page(int index) { return pages[index]; }
+
+		// Returns the smallest power of 2 that is at least n.
+		static int nextPowerOfTwo(int n);
+
+	private:
+		int maxSize;
+		bool powerOfTwo;
+		std::vector<Rect> rects;
+		std::vector<Page> pages;
+
+		long long packShelves(int pageWidth, std::vector<Rect> &rects, std::vector<Page> &pages);
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "TextureCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DecodePool.h"
+#include "FileIO.h"
+
+// Distinguishes the temporary files of concurrent stores
+static volatile int g_TemporaryCount = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+TextureCache::TextureCache(std::string const& directory)
+	: directory(directory)
+{
+	usable = !directory.empty() && FileIO::createDirectories(directory);
+	if (!directory.empty() && !usable) {
+		printf("Can't create texture cache directory %s\n", directory.c_str());
+	}
+}
+
+bool TextureCache::load(std::string const& filename, int depth, DecodedImage &image)
+{
+	if (!usable) {
+		return false;
+	}
+
+	struct stat source;
+	if (stat(filename.c_str(), &source) != 0) {
+		return false;
+	}
+
+	std::string entry = entryFilename(filename, depth);
+	int file = open(entry.c_str(), O_RDWR);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat info;
+	void *mapping = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size >= (off_t)sizeof(Header)) {
+		mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	if (mapping == MAP_FAILED) {
+		close(file);
+		return false;
+	}
+
+	Header const& header = *(Header const *)mapping;
+	bool valid = memcmp(header.magic, "SATC", 4) == 0 && header.version == VERSION
+		&& header.depth == depth
+		&& (off_t)(sizeof(Header) + header.dataSize) <= info.st_size
+		&& header.dataSize == (unsigned int)(header.width * header.height * header.bytesPerPixel);
+
+	// Fast path: the source is the same size and age as when it was cached.
+	// Otherwise the entry is only good if the contents are unchanged, in which
+	// case the header is brought up to date for next time.
+	if (valid && (header.sourceSize != source.st_size || header.sourceTime != source.st_mtime)) {
+		Hash::Value hash;
+		valid = header.sourceSize == source.st_size && hashFile(filename, hash) && hash == header.sourceHash;
+		if (valid) {
+			Header updated = header;
+			updated.sourceTime = source.st_mtime;
+			if (pwrite(file, &updated, sizeof(updated), 0) != (ssize_t)sizeof(updated)) {
+				printf("Can't update texture cache entry %s\n", entry.c_str());
+			}
+		}
+	}
+	close(file);
+
+	if (!valid) {
+		munmap(mapping, info.st_size);
+		return false;
+	}
+
+	image.width = header.width;
+	image.height = header.height;
+	image.format = header.format;
+	image.type = header.type;
+	image.bytesPerPixel = header.bytesPerPixel;
+	image.pitch = header.width * header.bytesPerPixel;
+	image.pixels = (const char *)mapping + sizeof(Header);
+	image.mapping = mapping;
+	image.mappingSize = info.st_size;
+	return true;
+}
+
+void TextureCache::store(std::string const& filename, int depth, DecodedImage const& image)
+{
+	if (!usable || image.pixels == NULL) {
+		return;
+	}
+
+	struct stat source;
+	Header header;
+	memset(&header, 0, sizeof(header));
+	if (stat(filename.c_str(), &source) != 0 || !hashFile(filename, header.sourceHash)) {
+		return;
+	}
+
+	int rowBytes = image.width * image.bytesPerPixel;
+	memcpy(header.magic, "SATC", 4);
+	header.version = VERSION;
+	header.sourceSize = source.st_size;
+	header.sourceTime = source.st_mtime;
+	header.depth = depth;
+	header.width = image.width;
+	header.height = image.height;
+	header.format = image.format;
+	header.type = image.type;
+	header.bytesPerPixel = image.bytesPerPixel;
+	header.dataSize = rowBytes * image.height;
+
+	std::string entry = entryFilename(filename, depth);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", (int)getpid(), __sync_fetch_and_add(&g_TemporaryCount, 1));
+	std::string temporary = entry + suffix;
+
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		return;
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+	const unsigned char *row = (const unsigned char *)image.pixels;
+	for (int y = 0; y < image.height && success; ++y, row += image.pitch) {
+		success = fwrite(row, 1, rowBytes, file) == (size_t)rowBytes;
+	}
+	success = fclose(file) == 0 && success;
+
+	if (!success || rename(temporary.c_str(), entry.c_str()) != 0) {
+		printf("Can't write texture cache entry %s\n", entry.c_str());
+		unlink(temporary.c_str());
+	}
+}
+
+void TextureCache::release(DecodedImage &image)
+{
+	if (image.mapping != NULL) {
+		munmap(image.mapping, image.mappingSize);
+		image.mapping = NULL;
+		image.pixels = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * entryFilename
+ * Returns the filename of the entry for an image, named by the hash of its
+ * filename and conversion settings.
+ */
+std::string TextureCache::entryFilename(std::string const& filename, int depth)
+{
+	Hash::Value key = Hash::fnv1a(filename);
+	key = Hash::fnv1a((long long)depth, key);
+	return directory + "/" + Hash::toHex(key) + ".tex";
+}
+
+/*
+ * hashFile
+ * Hashes the contents of a file.
+ *
+ * Returns
+ *     false if the file couldn't be read.
+ */
+bool TextureCache::hashFile(std::string const& filename, Hash::Value &hash)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	unsigned char buffer[16384];
+	size_t read;
+	hash = Hash::OFFSET_BASIS;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		hash = Hash::fnv1a(buffer, read, hash);
+	}
+
+	bool success = !ferror(file);
+	fclose(file);
+	return success;
+}
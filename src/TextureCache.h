@@ -0,0 +1,78 @@
+#ifndef __TEXTURECACHE_H__
+#define __TEXTURECACHE_H__
+
+#include <string>
+
+#include "Hash.h"
+
+struct DecodedImage;
+
+/*
+ * TextureCache
+ * Keeps decoded, upload-ready frames on disk, so later launches can skip
+ * decoding them.
+ *
+ * Each entry is keyed by the source filename and the conversion settings,
+ * and records the size, modification time and content hash of the source.
+ * An entry is trusted when the size and time still match; otherwise the
+ * source is hashed, and the entry is only used if the contents are unchanged.
+ *
+ * Entries are memory-mapped, so the pixels go to GL straight from the page
+ * cache. Each entry is written to a temporary file and renamed into place, so
+ * an interrupted write never leaves a broken entry, and the methods are safe
+ * to call from several threads.
+ */
+class TextureCache {
+	public:
+		// Constructor
+		// Arguments
+		//		directory: Directory holding the entries, created if necessary.
+		TextureCache(std::string const& directory);
+
+		// Maps the cached pixels of an image.
+		// Arguments
+		//		filename: Filename of the source image.
+		//		depth:    Bits per texel the image was converted to.
+		//		image:    Receives the pixels, which stay mapped until the image is released.
+		// Returns
+		//		false if there is no valid entry.
+		bool load(std::string const& filename, int depth, DecodedImage &image);
+
+		// Writes the pixels of a decoded image to the cache.
+		// Arguments
+		//		filename: Filename of the source image.
+		//		depth:    Bits per texel the image was converted to.
+		//		image:    The decoded image.
+		void store(std::string const& filename, int depth, DecodedImage const& image);
+
+		// Unmaps the pixels of an image loaded from the cache.
+		static void release(DecodedImage &image);
+
+	private:
+		enum {
+			VERSION = 1
+		};
+
+		// Header at the start of every entry, followed by the rows of pixels
+		struct Header {
+			char magic[4];                // "SATC"
+			unsigned int version;
+			long long sourceSize;
+			long long sourceTime;         // Modification time
+			Hash::Value sourceHash;       // Hash of the source contents
+			int depth;
+			int width, height;
+			int format, type;
+			int bytesPerPixel;
+			unsigned int dataSize;        // Bytes of pixels, with rows tightly packed
+			unsigned int padding[3];      // Keeps the pixels 8-byte aligned
+		};
+
+		std::string directory;
+		bool usable;
+
+		std::string entryFilename(std::string const& filename, int depth);
+		static bool hashFile(std::string const& filename, Hash::Value &hash);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "Transform.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+Transform::Transform()
+	: dirty(true), uploadedProgram(0), uploadedUniform(Shader::INVALID_UNIFORM), uploadCount(0)
+{
+}
+
+void Transform::upload(Shader *shader, Shader::Uniform uniform)
+{
+	if (dirty) {
+		product.multiply(projectionMatrix, modelviewMatrix);
+		dirty = false;
+		uploadedProgram = 0;
+	}
+
+	// Uniforms belong to the program, so the product stays put between frames
+	if (uploadedProgram == shader->id() && uploadedUniform == uniform) {
+		return;
+	}
+
+	shader->setUniformMatrix4(uniform, product.getRawMatrix());
+	uploadedProgram = shader->id();
+	uploadedUniform = uniform;
+	++uploadCount;
+}
@@ -0,0 +1,47 @@
+#ifndef __TRANSFORM_H__
+#define __TRANSFORM_H__
+
+#include "Shader.h"
+#include "TransformationMatrix.h"
+
+/*
+ * Transform
+ * Projection and modelview matrices, combined into a single
+ * model-view-projection matrix for the vertex shader.
+ *
+ * The product is only recomputed after either matrix was changed, and only
+ * uploaded when it, or the program it goes to, has changed. Frames with an
+ * unchanged transform make no matrix math or GL calls.
+ */
+class Transform {
+	public:
+		// Constructor
+		// Both matrices start out as the identity.
+		Transform();
+
+		// Return a matrix for modification, marking the product out of date.
+		TransformationMatrix &projection() { dirty = true; return projectionMatrix; }
+		TransformationMatrix &modelview() { dirty = true; return modelviewMatrix; }
+
+		// Uploads the product to a shader's MVP uniform, unless it's already there.
+		// The shader must be bound.
+		// Arguments
+		//		shader:  The shader.
+		//		uniform: Handle of the shader's MVP uniform.
+		void upload(Shader *shader, Shader::Uniform uniform);
+
+		// Returns the number of times the product was uploaded.
+		unsigned int uploads() { return uploadCount; }
+
+	private:
+		TransformationMatrix projectionMatrix;
+		TransformationMatrix modelviewMatrix;
+		TransformationMatrix product;
+		bool dirty;                   // Whether a matrix changed since the product was computed
+
+		unsigned int uploadedProgram; // Program holding the current product, or 0 if none
+		Shader::Uniform uploadedUniform;
+		unsigned int uploadCount;
+};
+
+#endif
@@ -1,117 +1,348 @@
 #include "TransformationMatrix.h"
 
+#include <cmath>
+
+#include "Float4.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+const TransformationMatrix::Constant TransformationMatrix::IDENTITY = TRANSFORMATION_IDENTITY;
+
+///////////////////////////////////////////////////////////////////////////////
+// Construction
+
+TransformationMatrix &TransformationMatrix::operator=(Constant const& constant)
+{
+	for (int column = 0; column < 4; ++column) {
+		store4(matrix[column], load4(constant.matrix[column]));
+	}
+	return *this;
+}
+
+bool TransformationMatrix::isAffine() const
+{
+	return matrix[0][3] == 0.0f && matrix[1][3] == 0.0f && matrix[2][3] == 0.0f && matrix[3][3] == 1.0f;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Projections
+//
+// Each column is written whole, zeros included.
 
 void TransformationMatrix::identityMatrix()
 {
-    memset(matrix, 0, sizeof(matrix));
-
-	matrix[0][0] = 1.0f;
-	matrix[1][1] = 1.0f;
-	matrix[2][2] = 1.0f;
-	matrix[3][3] = 1.0f;
+	*this = IDENTITY;
 }
 
 void TransformationMatrix::perspectiveMatrix(const float height, const float width, const float fov, const float near, const float far)
 {
-    memset(matrix, 0, sizeof(matrix));
+	float x = 1.0f / tanf(fov * 3.1415926535f / 360.0f);
 
-    matrix[0][0] = 1.0f / tanf(fov * 3.1415926535f / 360.0f);
-    matrix[1][1] = matrix[0][0] / (height / width);
-    matrix[2][2] = -(far + near) / (far - near);
-    matrix[2][3] = -1.0f;
-    matrix[3][2] = -2.0f * far * near / (far - near);
+	store4(matrix[0], make4(x, 0.0f, 0.0f, 0.0f));
+	store4(matrix[1], make4(0.0f, x / (height / width), 0.0f, 0.0f));
+	store4(matrix[2], make4(0.0f, 0.0f, -(far + near) / (far - near), -1.0f));
+	store4(matrix[3], make4(0.0f, 0.0f, -2.0f * far * near / (far - near), 0.0f));
 }
 
 void TransformationMatrix::orthographicMatrix(const float left, const float right, const float top, const float bottom, const float near, const float far)
 {
-    memset(matrix, 0, sizeof(matrix));
-
-	matrix[0][0] = 2.0f / (right - left);
-	matrix[1][1] = 2.0f / (top - bottom);
-	matrix[2][2] = -2.0f / (far - near);
-	matrix[3][0] = -(right + left)/(right - left);
-	matrix[3][1] = -(top + bottom)/(top - bottom);
-	matrix[3][2] = -(far + near)/(far - near);
-	matrix[3][3] = 1.0f;
+	const Constant constant = TRANSFORMATION_ORTHOGRAPHIC(left, right, top, bottom, near, far);
+	*this = constant;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Transformations
+// Transformations, applied after the existing transformation
+//
+// Multiplying on the left mixes the rows, so each column is updated on its own.
 
 void TransformationMatrix::translate(float x, float y, float z)
 {
-	matrix[0][0] += x * matrix[0][3];
-	matrix[0][1] += y * matrix[0][3];
-	matrix[0][2] += z * matrix[0][3];
-
-	matrix[1][0] += x * matrix[1][3];
-	matrix[1][1] += y * matrix[1][3];
-	matrix[1][2] += z * matrix[1][3];
+	// Each row gets the bottom row times the offset added to it
+	Float4 offset = make4(x, y, z, 0.0f);
+	for (int column = 0; column < 4; ++column) {
+		Float4 c = load4(matrix[column]);
+		store4(matrix[column], madd4(c, offset, splatW4(c)));
+	}
+}
 
-	matrix[2][0] += x * matrix[2][3];
-	matrix[2][1] += y * matrix[2][3];
-	matrix[2][2] += z * matrix[2][3];
+void TransformationMatrix::rotateX(float angle)
+{
+	rotateRows(1, 2, angle);
+}
 
-	matrix[3][0] += x * matrix[3][3];
-	matrix[3][1] += y * matrix[3][3];
-	matrix[3][2] += z * matrix[3][3];
+void TransformationMatrix::rotateY(float angle)
+{
+	rotateRows(2, 0, angle);
 }
 
 void TransformationMatrix::rotateZ(float angle)
 {
-	float tmp[4][2];
+	rotateRows(0, 1, angle);
+}
 
-	tmp[0][0] = cos(angle) * matrix[0][0] - sin(angle) * matrix[0][1];
-	tmp[0][1] = sin(angle) * matrix[0][0] + cos(angle) * matrix[0][1];
+void TransformationMatrix::scale(float scalar)
+{
+	// Scales through the w coordinate
+	Float4 factors = make4(1.0f, 1.0f, 1.0f, 1.0f / scalar);
+	for (int column = 0; column < 4; ++column) {
+		store4(matrix[column], mul4(load4(matrix[column]), factors));
+	}
+}
 
-	tmp[1][0] = cos(angle) * matrix[1][0] - sin(angle) * matrix[1][1];
-	tmp[1][1] = sin(angle) * matrix[1][0] + cos(angle) * matrix[1][1];
+void TransformationMatrix::scale(float sX, float sY, float sZ)
+{
+	Float4 factors = make4(sX, sY, sZ, 1.0f);
+	for (int column = 0; column < 4; ++column) {
+		store4(matrix[column], mul4(load4(matrix[column]), factors));
+	}
+}
 
-	tmp[2][0] = cos(angle) * matrix[2][0] - sin(angle) * matrix[2][1];
-	tmp[2][1] = sin(angle) * matrix[2][0] + cos(angle) * matrix[2][1];
+///////////////////////////////////////////////////////////////////////////////
+// Transformations, applied before the existing transformation
+//
+// Multiplying on the right mixes whole columns.
 
-	tmp[3][0] = cos(angle) * matrix[3][0] - sin(angle) * matrix[3][1];
-	tmp[3][1] = sin(angle) * matrix[3][0] + cos(angle) * matrix[3][1];
+void TransformationMatrix::postTranslate(float x, float y, float z)
+{
+	Float4 c = load4(matrix[3]);
+	c = madd4(c, load4(matrix[0]), splat4(x));
+	c = madd4(c, load4(matrix[1]), splat4(y));
+	c = madd4(c, load4(matrix[2]), splat4(z));
+	store4(matrix[3], c);
+}
 
-	matrix[0][0] = tmp[0][0];
-	matrix[0][1] = tmp[0][1];
+void TransformationMatrix::postRotateX(float angle)
+{
+	rotateColumns(1, 2, angle);
+}
 
-	matrix[1][0] = tmp[1][0];
-	matrix[1][1] = tmp[1][1];
+void TransformationMatrix::postRotateY(float angle)
+{
+	rotateColumns(2, 0, angle);
+}
 
-	matrix[2][0] = tmp[2][0];
-	matrix[2][1] = tmp[2][1];
+void TransformationMatrix::postRotateZ(float angle)
+{
+	rotateColumns(0, 1, angle);
+}
 
-	matrix[3][0] = tmp[3][0];
-	matrix[3][1] = tmp[3][1];
+void TransformationMatrix::postScale(float sX, float sY, float sZ)
+{
+	store4(matrix[0], mul4(load4(matrix[0]), splat4(sX)));
+	store4(matrix[1], mul4(load4(matrix[1]), splat4(sY)));
+	store4(matrix[2], mul4(load4(matrix[2]), splat4(sZ)));
 }
 
-void TransformationMatrix::scale(float scalar)
+///////////////////////////////////////////////////////////////////////////////
+// Composition
+
+void TransformationMatrix::multiply(TransformationMatrix const& lhs, TransformationMatrix const& rhs)
 {
-	matrix[0][3] /= scalar;
-	matrix[1][3] /= scalar;
-	matrix[2][3] /= scalar;
-	matrix[3][3] /= scalar;
+	if (rhs.isAffine()) {
+		multiplyColumns<true>(lhs, rhs);
+	} else {
+		multiplyColumns<false>(lhs, rhs);
+	}
 }
 
-void TransformationMatrix::scale(float sX, float sY, float sZ)
+void TransformationMatrix::transpose()
+{
+#if defined(__SSE__)
+	Float4 c0 = load4(matrix[0]);
+	Float4 c1 = load4(matrix[1]);
+	Float4 c2 = load4(matrix[2]);
+	Float4 c3 = load4(matrix[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	store4(matrix[0], c0);
+	store4(matrix[1], c1);
+	store4(matrix[2], c2);
+	store4(matrix[3], c3);
+#elif defined(__ARM_NEON__)
+	// De-interleaving every fourth float loads the rows
+	float32x4x4_t rows = vld4q_f32(&matrix[0][0]);
+	store4(matrix[0], rows.val[0]);
+	store4(matrix[1], rows.val[1]);
+	store4(matrix[2], rows.val[2]);
+	store4(matrix[3], rows.val[3]);
+#else
+	for (int column = 0; column < 4; ++column) {
+		for (int row = column + 1; row < 4; ++row) {
+			float swap = matrix[column][row];
+			matrix[column][row] = matrix[row][column];
+			matrix[row][column] = swap;
+		}
+	}
+#endif
+}
+
+bool TransformationMatrix::invertAffine()
+{
+	// The upper 3x3, by row and column
+	float a00 = matrix[0][0], a01 = matrix[1][0], a02 = matrix[2][0];
+	float a10 = matrix[0][1], a11 = matrix[1][1], a12 = matrix[2][1];
+	float a20 = matrix[0][2], a21 = matrix[1][2], a22 = matrix[2][2];
+
+	// Cofactors of the first row give the determinant
+	float c00 = a11 * a22 - a12 * a21;
+	float c01 = a12 * a20 - a10 * a22;
+	float c02 = a10 * a21 - a11 * a20;
+	float determinant = a00 * c00 + a01 * c01 + a02 * c02;
+	if (determinant == 0.0f || determinant != determinant) {
+		return false;
+	}
+
+	// The inverse of the 3x3 is its adjugate over the determinant
+	float d = 1.0f / determinant;
+	float i00 = c00 * d, i01 = (a02 * a21 - a01 * a22) * d, i02 = (a01 * a12 - a02 * a11) * d;
+	float i10 = c01 * d, i11 = (a00 * a22 - a02 * a20) * d, i12 = (a02 * a10 - a00 * a12) * d;
+	float i20 = c02 * d, i21 = (a01 * a20 - a00 * a21) * d, i22 = (a00 * a11 - a01 * a10) * d;
+
+	// The translation is undone after the inverted 3x3
+	float tx = matrix[3][0], ty = matrix[3][1], tz = matrix[3][2];
+
+	store4(matrix[0], make4(i00, i10, i20, 0.0f));
+	store4(matrix[1], make4(i01, i11, i21, 0.0f));
+	store4(matrix[2], make4(i02, i12, i22, 0.0f));
+	store4(matrix[3], make4(
+			-(i00 * tx + i01 * ty + i02 * tz),
+			-(i10 * tx + i11 * ty + i12 * tz),
+			-(i20 * tx + i21 * ty + i22 * tz),
+			1.0f));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Transforming
+
+void TransformationMatrix::transform(const float *vector, float *result) const
+{
+	float x = vector[0], y = vector[1], z = vector[2], w = vector[3];
+
+	Float4 c = mul4(load4(matrix[0]), splat4(x));
+	c = madd4(c, load4(matrix[1]), splat4(y));
+	c = madd4(c, load4(matrix[2]), splat4(z));
+	c = madd4(c, load4(matrix[3]), splat4(w));
+	store4(result, c);
+}
+
+void TransformationMatrix::transformPoints(const float *points, float *results, int count) const
+{
+	Float4 c0 = load4(matrix[0]);
+	Float4 c1 = load4(matrix[1]);
+	Float4 c2 = load4(matrix[2]);
+	Float4 c3 = load4(matrix[3]);
+
+	for (int i = 0; i < count; ++i, points += 3, results += 3) {
+		float x = points[0], y = points[1], z = points[2];
+
+		Float4 c = madd4(c3, c0, splat4(x));
+		c = madd4(c, c1, splat4(y));
+		c = madd4(c, c2, splat4(z));
+		store3(results, c);
+	}
+}
+
+void TransformationMatrix::transformVectors(const float *vectors, float *results, int count) const
 {
-	matrix[0][0] *= sX;
-	matrix[0][1] *= sY;
-	matrix[0][2] *= sZ;
+	Float4 c0 = load4(matrix[0]);
+	Float4 c1 = load4(matrix[1]);
+	Float4 c2 = load4(matrix[2]);
+
+	for (int i = 0; i < count; ++i, vectors += 3, results += 3) {
+		float x = vectors[0], y = vectors[1], z = vectors[2];
 
-	matrix[1][0] *= sX;
-	matrix[1][1] *= sY;
-	matrix[1][2] *= sZ;
+		Float4 c = mul4(c0, splat4(x));
+		c = madd4(c, c1, splat4(y));
+		c = madd4(c, c2, splat4(z));
+		store3(results, c);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * multiplyColumns
+ * Sets this matrix to lhs * rhs. Each result column is lhs applied to the
+ * rhs column. All of lhs, and each rhs column, are read before anything is
+ * written, so either may be this matrix.
+ *
+ * Template arguments
+ *     affine: Whether rhs's bottom row is (0, 0, 0, 1). Its first three
+ *             columns then take nothing from lhs's last column, and the
+ *             last takes it unscaled.
+ */
+template <bool affine>
+void TransformationMatrix::multiplyColumns(TransformationMatrix const& lhs, TransformationMatrix const& rhs)
+{
+	Float4 l0 = load4(lhs.matrix[0]);
+	Float4 l1 = load4(lhs.matrix[1]);
+	Float4 l2 = load4(lhs.matrix[2]);
+	Float4 l3 = load4(lhs.matrix[3]);
 
-	matrix[2][0] *= sX;
-	matrix[2][1] *= sY;
-	matrix[2][2] *= sZ;
+	for (int column = 0; column < 3; ++column) {
+		const float *r = rhs.matrix[column];
+		float x = r[0], y = r[1], z = r[2], w = r[3];
 
-	matrix[3][0] *= sX;
-	matrix[3][1] *= sY;
-	matrix[3][2] *= sZ;
+		Float4 c = mul4(l0, splat4(x));
+		c = madd4(c, l1, splat4(y));
+		c = madd4(c, l2, splat4(z));
+		if (!affine) {
+			c = madd4(c, l3, splat4(w));
+		}
+		store4(matrix[column], c);
+	}
+
+	const float *r = rhs.matrix[3];
+	float x = r[0], y = r[1], z = r[2], w = r[3];
+
+	Float4 c = affine ? madd4(l3, l0, splat4(x)) : madd4(mul4(l3, splat4(w)), l0, splat4(x));
+	c = madd4(c, l1, splat4(y));
+	c = madd4(c, l2, splat4(z));
+	store4(matrix[3], c);
 }
 
+/*
+ * rotateRows
+ * Multiplies a rotation onto the left of the matrix, which mixes two rows
+ * of every column. Row i goes towards row j as the angle grows.
+ *
+ * Arguments
+ *     i, j:  Rows in the plane of the rotation.
+ *     angle: Angle in radians.
+ */
+void TransformationMatrix::rotateRows(int i, int j, float angle)
+{
+	float s, c;
+	sincosf(angle, &s, &c);
+
+	for (int column = 0; column < 4; ++column) {
+		float a = matrix[column][i];
+		float b = matrix[column][j];
+		matrix[column][i] = c * a - s * b;
+		matrix[column][j] = s * a + c * b;
+	}
+}
+
+/*
+ * rotateColumns
+ * Multiplies a rotation onto the right of the matrix, which mixes two of
+ * its columns.
+ *
+ * Arguments
+ *     i, j:  Columns in the plane of the rotation.
+ *     angle: Angle in radians.
+ */
+void TransformationMatrix::rotateColumns(int i, int j, float angle)
+{
+	float s, c;
+	sincosf(angle, &s, &c);
+
+	Float4 a = load4(matrix[i]);
+	Float4 b = load4(matrix[j]);
+	Float4 cosine = splat4(c);
+	Float4 sine = splat4(s);
+	store4(matrix[i], madd4(mul4(a, cosine), b, sine));
+	store4(matrix[j], sub4(mul4(b, cosine), mul4(a, sine)));
+}
@@ -1,32 +1,127 @@
 #ifndef __TRANSFORMATIONMATRIX_H__
 #define __TRANSFORMATIONMATRIX_H__
 
-#include <cmath>
-
-#include "PDL.h"
-
+/*
+ * TransformationMatrix
+ * 4x4 matrix for transforming homogeneous coordinates, stored column by
+ * column as GL expects.
+ *
+ * Each column is one 16-byte-aligned vector of four floats, and the
+ * operations work on whole columns with SSE or NEON where available, or
+ * with plain floats otherwise.
+ *
+ * translate(), rotate*() and scale() multiply the transformation onto the
+ * left (M = T * M), so it applies after the matrix's existing one. The post*
+ * versions multiply it onto the right (M = M * T), so it applies first.
+ *
+ * Matrices known at compile time are Constants, built with the
+ * TRANSFORMATION_* initializers below. They're plain data, so a static
+ * Constant is stored read-only in the executable rather than computed when
+ * the program starts.
+ */
 class TransformationMatrix
 {
 	private:
-		float matrix[4][4];
+		float matrix[4][4] __attribute__((aligned(16)));  // [column][row]
 
 	public:
-		// Constructor
-		TransformationMatrix() { identityMatrix(); }
+		// Elements of a matrix, laid out the same way
+		struct Constant {
+			float matrix[4][4];  // [column][row]
+		};
+
+		static const Constant IDENTITY;
+
+		// Constructors
+		TransformationMatrix() { *this = IDENTITY; }
+		TransformationMatrix(Constant const& constant) { *this = constant; }
+
+		TransformationMatrix &operator=(Constant const& constant);
 
-		// Accessor
-		const float *getRawMatrix() { return &matrix[0][0]; }
+		// Accessors
+		const float *getRawMatrix() const { return &matrix[0][0]; }
+		float element(int row, int column) const { return matrix[column][row]; }
+
+		// Returns true if the bottom row is (0, 0, 0, 1), as it is for any
+		// combination of translations, rotations and scales.
+		bool isAffine() const;
 
 		// Projections
 		void identityMatrix();
 		void perspectiveMatrix(const float height, const float width, const float fov, const float near, const float far);
 		void orthographicMatrix(const float left, const float right, const float top, const float bottom, const float near, const float far);
 
-		// Transformations
+		// Transformations, applied after the existing transformation
 		void translate(float x, float y, float z = 0.0f);
+		void rotateX(float angle);
+		void rotateY(float angle);
 		void rotateZ(float angle);
 		void scale(float scalar);
 		void scale(float sX, float sY, float sZ = 1.0f);
+
+		// Transformations, applied before the existing transformation
+		void postTranslate(float x, float y, float z = 0.0f);
+		void postRotateX(float angle);
+		void postRotateY(float angle);
+		void postRotateZ(float angle);
+		void postScale(float sX, float sY, float sZ = 1.0f);
+
+		// Composition
+		// Sets this matrix to lhs * rhs, which applies rhs first. Either may be this matrix.
+		// An affine rhs skips its bottom row.
+		void multiply(TransformationMatrix const& lhs, TransformationMatrix const& rhs);
+
+		// Swaps rows and columns.
+		void transpose();
+
+		// Inverts a matrix whose bottom row is (0, 0, 0, 1).
+		// Returns false, leaving the matrix unchanged, if it isn't invertible.
+		bool invertAffine();
+
+		// Transforming
+		// Transforms a 4 component vector. result may be vector.
+		void transform(const float *vector, float *result) const;
+
+		// Transform arrays of 3 component points (w = 1) and direction vectors
+		// (w = 0), without dividing by w. results may be the input array.
+		void transformPoints(const float *points, float *results, int count) const;
+		void transformVectors(const float *vectors, float *results, int count) const;
+
+	private:
+		template <bool affine> void multiplyColumns(TransformationMatrix const& lhs, TransformationMatrix const& rhs);
+		void rotateRows(int i, int j, float angle);
+		void rotateColumns(int i, int j, float angle);
 };
 
+// Initializers for TransformationMatrix::Constant. With constant arguments
+// they're constant expressions, e.g.
+//     static const TransformationMatrix::Constant ORTHO = TRANSFORMATION_ORTHOGRAPHIC(-1, 1, -1, 1, -1, 1);
+#define TRANSFORMATION_IDENTITY \
+	{ { { 1.0f, 0.0f, 0.0f, 0.0f }, \
+	    { 0.0f, 1.0f, 0.0f, 0.0f }, \
+	    { 0.0f, 0.0f, 1.0f, 0.0f }, \
+	    { 0.0f, 0.0f, 0.0f, 1.0f } } }
+
+#define TRANSFORMATION_TRANSLATE(x, y, z) \
+	{ { { 1.0f, 0.0f, 0.0f, 0.0f }, \
+	    { 0.0f, 1.0f, 0.0f, 0.0f }, \
+	    { 0.0f, 0.0f, 1.0f, 0.0f }, \
+	    { (float)(x), (float)(y), (float)(z), 1.0f } } }
+
+#define TRANSFORMATION_SCALE(sX, sY, sZ) \
+	{ { { (float)(sX), 0.0f, 0.0f, 0.0f }, \
+	    { 0.0f, (float)(sY), 0.0f, 0.0f }, \
+	    { 0.0f, 0.0f, (float)(sZ), 0.0f }, \
+	    { 0.0f, 0.0f, 0.0f, 1.0f } } }
+
+// Same arguments, and the same matrix, as orthographicMatrix()
+#define TRANSFORMATION_ORTHOGRAPHIC(left, right, top, bottom, near, far) \
+	{ { { 2.0f / ((float)(right) - (float)(left)), 0.0f, 0.0f, 0.0f }, \
+	    { 0.0f, 2.0f / ((float)(top) - (float)(bottom)), 0.0f, 0.0f }, \
+	    { 0.0f, 0.0f, -2.0f / ((float)(far) - (float)(near)), 0.0f }, \
+	    { -((float)(right) + (float)(left)) / ((float)(right) - (float)(left)), \
+	      -((float)(top) + (float)(bottom)) / ((float)(top) - (float)(bottom)), \
+	      -((float)(far) + (float)(near)) / ((float)(far) - (float)(near)), \
+	      1.0f } } }
+
 #endif
@@ -0,0 +1,87 @@
+#ifndef __TRIPLEBUFFER_H__
+#define __TRIPLEBUFFER_H__
+
+/*
+ * TripleBuffer
+ * Lock-free handoff of the latest value from one writer thread to one reader thread.
+ *
+ * The writer and reader each own a slot, and a third slot is swapped between
+ * them atomically, so neither side ever blocks on the other. The reader always
+ * sees the most recently published value; intermediate values may be dropped.
+ */
+template <class T>
+class TripleBuffer
+{
+	private:
+		enum {
+			INDEX_MASK = 3,  // Bits holding the slot index
+			DIRTY = 4        // Set when the shared slot holds an unread value
+		};
+
+		T buffer[3];
+		volatile int shared;  // Slot in the middle, with the DIRTY flag
+		int back;             // Slot owned by the writer
+		int front;            // Slot owned by the reader
+
+		static int exchange(volatile int *target, int value);
+
+	public:
+		TripleBuffer(T const& initial = T());
+
+		// Writer: returns the slot to fill before calling publish().
+		T &writeBuffer() { return buffer[back]; }
+
+		// Writer: makes the write buffer visible to the reader.
+		void publish();
+
+		// Writer: stores and publishes a value.
+		void write(T const& value) { buffer[back] = value; publish(); }
+
+		// Reader: picks up the most recently published value, if there is a new one.
+		// Returns true if a new value was picked up.
+		bool update();
+
+		// Reader: returns the most recently published value.
+		T const& read() { update(); return buffer[front]; }
+};
+
+template <class T>
+TripleBuffer<T>::TripleBuffer(T const& initial)
+	: shared(1), back(0), front(2)
+{
+	buffer[0] = initial;
+	buffer[1] = initial;
+	buffer[2] = initial;
+}
+
+template <class T>
+void TripleBuffer<T>::publish()
+{
+	back = exchange(&shared, back | DIRTY) & INDEX_MASK;
+}
+
+template <class T>
+bool TripleBuffer<T>::update()
+{
+	if (!(shared & DIRTY)) {
+		return false;
+	}
+
+	front = exchange(&shared, front) & INDEX_MASK;
+	return true;
+}
+
+// Atomically stores a value, returning the previous value.
+// The compare-and-swap is a full memory barrier, so slot contents written
+// before the exchange are visible to the other thread after it.
+template <class T>
+int TripleBuffer<T>::exchange(volatile int *target, int value)
+{
+	int previous;
+	do {
+		previous = *target;
+	} while (__sync_val_compare_and_swap(target, previous, value) != previous);
+	return previous;
+}
+
+#endif
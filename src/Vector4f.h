@@ -0,0 +1,203 @@
+#ifndef __VECTOR4F_H__
+#define __VECTOR4F_H__
+
+#include <cmath>
+
+#include "Float4.h"
+
+/*
+ * Vector4f
+ * Four component vector of floats, operated on as one Float4.
+ *
+ * Arithmetic on vectors builds an expression instead of a result, and the
+ * whole expression is evaluated when it's assigned to a Vector4f, in
+ * registers and without temporary vectors. The expressions hold references
+ * to their operands, so they only live until the end of the statement.
+ *
+ * w takes part in every operation. It's 0 for vectors made from three
+ * components, and stays 0 through sums, differences and scaling, so those
+ * behave as three component vectors.
+ *
+ * There's no user-declared copy constructor or assignment, so vectors copy
+ * as plain data.
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+// Expressions
+
+// Base of every vector expression, so the operators only match vectors.
+// E::evaluate() returns the expression's value.
+template <class E>
+struct VectorExpression {
+	E const& self() const { return static_cast<E const&>(*this); }
+	Float4 evaluate() const { return self().evaluate(); }
+};
+
+template <class L, class R>
+struct VectorSum : public VectorExpression<VectorSum<L, R> > {
+	L const& lhs;
+	R const& rhs;
+
+	VectorSum(L const& lhs, R const& rhs) : lhs(lhs), rhs(rhs) {}
+	Float4 evaluate() const { return add4(lhs.evaluate(), rhs.evaluate()); }
+};
+
+template <class L, class R>
+struct VectorDifference : public VectorExpression<VectorDifference<L, R> > {
+	L const& lhs;
+	R const& rhs;
+
+	VectorDifference(L const& lhs, R const& rhs) : lhs(lhs), rhs(rhs) {}
+	Float4 evaluate() const { return sub4(lhs.evaluate(), rhs.evaluate()); }
+};
+
+template <class E>
+struct VectorScaled : public VectorExpression<VectorScaled<E> > {
+	E const& vector;
+	float scalar;
+
+	VectorScaled(E const& vector, float scalar) : vector(vector), scalar(scalar) {}
+	Float4 evaluate() const { return mul4(vector.evaluate(), splat4(scalar)); }
+};
+
+// a + b * s, evaluated as one multiply-add
+template <class L, class R>
+struct VectorScaledSum : public VectorExpression<VectorScaledSum<L, R> > {
+	L const& lhs;
+	VectorScaled<R> const& rhs;
+
+	VectorScaledSum(L const& lhs, VectorScaled<R> const& rhs) : lhs(lhs), rhs(rhs) {}
+	Float4 evaluate() const { return madd4(lhs.evaluate(), rhs.vector.evaluate(), splat4(rhs.scalar)); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Vector
+
+struct Vector4f : public VectorExpression<Vector4f> {
+	public:
+		// Fields
+		// The lanes are one array, so Float4 loads and stores stay within it
+		float v[4];
+
+		// Constructors
+		Vector4f() {
+			store4(v, splat4(0.0f));
+		}
+		Vector4f(const float x, const float y, const float z, const float w = 0.0f) {
+			v[0] = x;
+			v[1] = y;
+			v[2] = z;
+			v[3] = w;
+		}
+
+		// Evaluates an expression
+		template <class E>
+		Vector4f(VectorExpression<E> const& expression) { store4(v, expression.evaluate()); }
+
+		// Accessors
+		float &x() { return v[0]; }
+		float &y() { return v[1]; }
+		float &z() { return v[2]; }
+		float &w() { return v[3]; }
+		float x() const { return v[0]; }
+		float y() const { return v[1]; }
+		float z() const { return v[2]; }
+		float w() const { return v[3]; }
+
+		// Operator overloads
+		template <class E>
+		Vector4f & operator=(VectorExpression<E> const& expression) {
+			store4(v, expression.evaluate());
+			return *this;
+		}
+		template <class E>
+		Vector4f & operator+=(VectorExpression<E> const& rhs) {
+			store4(v, add4(evaluate(), rhs.evaluate()));
+			return *this;
+		}
+		template <class E>
+		Vector4f & operator-=(VectorExpression<E> const& rhs) {
+			store4(v, sub4(evaluate(), rhs.evaluate()));
+			return *this;
+		}
+		Vector4f & operator*=(const float scalar) {
+			store4(v, mul4(evaluate(), splat4(scalar)));
+			return *this;
+		}
+		Vector4f & operator/=(const float scalar) {
+			return *this *= 1.0f / scalar;
+		}
+
+		// Methods
+		Float4 evaluate() const { return load4(v); }
+
+		template <class E>
+		float dot(VectorExpression<E> const& rhs) const { return sum4(mul4(evaluate(), rhs.evaluate())); }
+
+		float magnitudeSquared() const { return dot(*this); }
+		float magnitude() const { return sqrtf(magnitudeSquared()); }
+
+		// Returns an approximation of 1 / magnitude(), to about 1 part in 10^5.
+		// Infinite for a zero vector.
+		float inverseMagnitude() const { return rsqrt(magnitudeSquared()); }
+
+		// Scales the vector to a magnitude of 1, to the accuracy of
+		// inverseMagnitude(). A zero vector becomes NaN.
+		void normalize() { *this *= inverseMagnitude(); }
+		Vector4f normalized() const;
+} __attribute__((aligned(16)));
+
+///////////////////////////////////////////////////////////////////////////////
+// Operators
+
+template <class L, class R>
+inline VectorSum<L, R> operator+(VectorExpression<L> const& lhs, VectorExpression<R> const& rhs)
+{
+	return VectorSum<L, R>(lhs.self(), rhs.self());
+}
+
+template <class L, class R>
+inline VectorScaledSum<L, R> operator+(VectorExpression<L> const& lhs, VectorScaled<R> const& rhs)
+{
+	return VectorScaledSum<L, R>(lhs.self(), rhs);
+}
+
+template <class L, class R>
+inline VectorDifference<L, R> operator-(VectorExpression<L> const& lhs, VectorExpression<R> const& rhs)
+{
+	return VectorDifference<L, R>(lhs.self(), rhs.self());
+}
+
+template <class E>
+inline VectorScaled<E> operator*(VectorExpression<E> const& vector, const float scalar)
+{
+	return VectorScaled<E>(vector.self(), scalar);
+}
+
+template <class E>
+inline VectorScaled<E> operator*(const float scalar, VectorExpression<E> const& vector)
+{
+	return VectorScaled<E>(vector.self(), scalar);
+}
+
+template <class E>
+inline VectorScaled<E> operator/(VectorExpression<E> const& vector, const float scalar)
+{
+	return VectorScaled<E>(vector.self(), 1.0f / scalar);
+}
+
+template <class E>
+inline VectorScaled<E> operator-(VectorExpression<E> const& vector)
+{
+	return VectorScaled<E>(vector.self(), -1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Methods using the operators
+
+inline Vector4f Vector4f::normalized() const
+{
+	return *this * inverseMagnitude();
+}
+
+#endif
@@ -10,30 +10,105 @@
 #include "json/value.h"
 
 #include "Accelerometer.h"
+#include "AllocationCounter.h"
 #include "Animation.h"
+#include "Clock.h"
 #include "Exceptions.h"
 #include "FileIO.h"
+#include "FrameArena.h"
+#include "FrameScheduler.h"
+#include "GLState.h"
 #include "Model.h"
+#include "Pipeline.h"
+#include "Profiler.h"
+#include "RenderTarget.h"
+#include "ResolutionGovernor.h"
+#include "ScreenQuad.h"
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "ShaderVariants.h"
+#include "Transform.h"
 #include "TransformationMatrix.h"
-#include "Vector3f.h"
+#include "Vector4f.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constants
 
 const std::string CONFIG_FILE = "config.json";
 
+// Shader that stretches a reduced-resolution frame over the screen
+const std::string UPSCALE_VERTEX_SHADER   = "upscale.vert";
+const std::string UPSCALE_FRAGMENT_SHADER = "upscale.frag";
+
+// Timestep for the simulation thread
+const Clock::Nanoseconds SIMULATION_STEP = 1000000000LL / 60; // Update physics at 60fps
+const Clock::Nanoseconds MAX_FRAME_TIME = 250000000LL; // Slow down physics simulation if going slower than 4fps
+
+// Space for the transient objects of a frame
+const size_t FRAME_ARENA_SIZE = 4096;
+
+// Interval between frame statistics reports
+const Clock::Nanoseconds STATISTICS_INTERVAL = 10000000000LL;
+
+// Projection for the screen quad, which spans -1 to 1
+const TransformationMatrix::Constant PROJECTION = TRANSFORMATION_ORTHOGRAPHIC(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Globals
 
 SDL_Surface  *g_ScreenSurface;
 
-TransformationMatrix *g_ProjectionMatrix;
+Transform *g_Transform;
+ShaderCache *g_ShaderCache;
+ShaderVariants *g_ShaderVariants;
 Shader *g_Shader;
+Shader::Uniform g_MVPUniform;
+Shader::Uniform g_TextureUniform;
+Shader::Uniform g_NextTextureUniform;
+Shader::Uniform g_FrameBlendUniform;
+bool g_Crossfade;  // Blend between adjacent frames
 Animation *g_Animation;
+ScreenQuad *g_ScreenQuad;
+
+ShaderVariants *g_UpscaleShaderVariants;
+RenderTarget *g_RenderTarget;             // NULL when always rendering at full resolution
+ResolutionGovernor *g_ResolutionGovernor; // NULL when the render scale is fixed
 
 Accelerometer *g_Accelerometer;
 Model *g_Model;
+Pipeline *g_Pipeline;
+
+FrameScheduler *g_FrameScheduler;
+FrameArena *g_FrameArena;
+
+// State of the most recently presented frame
+struct RenderState {
+	int frame;
+	int nextFrame, blend;  // Frame being crossfaded to, and how far, in 1/255ths
+	int width, height;
+	float scale;
+	unsigned int shader;
+
+	bool operator==(const RenderState &rhs) const {
+		return frame == rhs.frame
+			&& nextFrame == rhs.nextFrame && blend == rhs.blend
+			&& width == rhs.width && height == rhs.height && scale == rhs.scale
+			&& shader == rhs.shader;
+	}
+};
+
+RenderState g_LastRenderState;
+bool g_RenderInvalid = true;  // Forces the next frame to be drawn
+int g_RenderedFrames = 0;
+int g_SkippedFrames = 0;
+
+// Simulation steps seen by each display frame
+unsigned int g_LastStep = 0;
+int g_RepeatedStepFrames = 0;  // Frames with no new simulation step
+int g_MultiStepFrames = 0;     // Frames that advanced by more than one step
+
+// Frames in which the main thread allocated from the heap
+int g_AllocatingFrames = 0;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Initialization
@@ -61,33 +136,71 @@ void InitializeSDL()
 }
 
 // Initialize the OpenGL system
-void InitializeGL(std::string vertexShaderFile, std::string fragmentShaderFile)
+void InitializeGL(std::string vertexShaderFile, std::string fragmentShaderFile, bool crossfade,
+		ShaderVariants::Precision precision, std::string shaderCacheDirectory)
 {
-	// Set up the GLSL shader
-	g_Shader = new Shader(vertexShaderFile, fragmentShaderFile);
+	// Set up the GLSL shader variant, from the program cache if it was linked before
+	Clock::Nanoseconds shaderStart = Clock::now();
+	g_ShaderCache = new ShaderCache(shaderCacheDirectory);
+	g_ShaderVariants = new ShaderVariants(vertexShaderFile, fragmentShaderFile, g_ShaderCache);
+	g_Crossfade = crossfade;
+	g_Shader = g_ShaderVariants->get(crossfade ? "CROSSFADE" : "", precision);
+	printf("Shader ready in %.2f ms%s\n", Clock::toMilliseconds(Clock::now() - shaderStart),
+			g_ShaderCache->hits() > 0 ? " from the program cache" : "");
+	g_MVPUniform              = g_Shader->uniformHandle("MVP");
+	g_TextureUniform          = g_Shader->uniformHandle("Texture");
+	g_NextTextureUniform      = g_Shader->uniformHandle("NextTexture");
+	g_FrameBlendUniform       = g_Shader->uniformHandle("FrameBlend");
     
     // Set up the Projection matrix
-	g_ProjectionMatrix = new TransformationMatrix();
+	// The modelview matrix stays the identity
+	g_Transform = new Transform();
 	
-	//g_ProjectionMatrix->perspectiveMatrix(g_ScreenSurface->h, g_ScreenSurface->w, 70.0f, 0.1f, 200.0f);
-	g_ProjectionMatrix->orthographicMatrix(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+	//g_Transform->projection().perspectiveMatrix(g_ScreenSurface->h, g_ScreenSurface->w, 70.0f, 0.1f, 200.0f);
+	g_Transform->projection() = PROJECTION;
 
     // Basic GL setup
-    glClearColor(0.0, 0.0, 0.0, 1.0);
-    glEnable    (GL_CULL_FACE);
-    glCullFace  (GL_BACK);
+    GLState::clearColor(0.0, 0.0, 0.0, 1.0);
+    GLState::cullFace(true, GL_BACK);
+}
+
+// Initialize rendering at a reduced resolution
+// Arguments
+//		scale:        Fraction of the screen resolution to render at
+//		minimumScale: Fraction the resolution may be lowered to while frames are slow
+//		deep:         Whether to keep 24-bit color at the reduced resolution
+void InitializeRenderTarget(float scale, float minimumScale, bool deep)
+{
+	bool adaptive = minimumScale < scale;
+	if (scale >= 1.0f && !adaptive) {
+		return;
+	}
+
+	g_UpscaleShaderVariants = new ShaderVariants(UPSCALE_VERTEX_SHADER, UPSCALE_FRAGMENT_SHADER, g_ShaderCache);
+	Shader *upscaleShader = g_UpscaleShaderVariants->get("", ShaderVariants::PRECISION_MEDIUM);
+	g_RenderTarget = new RenderTarget(upscaleShader, g_ScreenSurface->w, g_ScreenSurface->h, deep);
+	if (!g_RenderTarget->usable()) {
+		return;
+	}
+
+	g_RenderTarget->setScale(scale);
+	if (adaptive) {
+		g_ResolutionGovernor = new ResolutionGovernor(minimumScale, scale);
+	}
 }
 
 // Initialize model
 void InitializeModel(float sensitivity)
 {
 	g_Model = new Model(g_Accelerometer, sensitivity);
+	g_Pipeline = new Pipeline(g_Accelerometer, g_Model, SIMULATION_STEP, MAX_FRAME_TIME);
 }
 
 // Initialize animations
-void InitializeAnimations(std::vector<std::string> frames)
+void InitializeAnimations(std::vector<std::string> frames, Animation::Options const& options)
 {
-	g_Animation = new Animation(frames);
+	g_Animation = new Animation(frames, options);
+	g_ScreenQuad = new ScreenQuad(g_Animation, g_ScreenSurface->w, g_ScreenSurface->h);
 }
 
 // Initialize our program
@@ -99,7 +212,15 @@ void Initialize()
 
 	std::string vertexShaderFile   = config["vertexShader"].asString();
 	std::string fragmentShaderFile = config["fragmentShader"].asString();
-    InitializeGL(vertexShaderFile, fragmentShaderFile);
+	bool crossfade = config.get("crossfade", false).asBool();
+	ShaderVariants::Precision precision = ShaderVariants::parsePrecision(
+			config.get("fragmentPrecision", "highp").asString(), ShaderVariants::PRECISION_HIGH);
+	std::string shaderCacheDirectory = config.get("shaderCache", "").asString();
+    InitializeGL(vertexShaderFile, fragmentShaderFile, crossfade, precision, shaderCacheDirectory);
+
+	float renderScale = config.get("renderScale", 1.0).asDouble();
+	float minimumRenderScale = config.get("minimumRenderScale", renderScale).asDouble();
+	InitializeRenderTarget(renderScale, minimumRenderScale, config.get("textureDepth", 32).asInt() != 16);
 
 	float sensitivity = config["sensitivity"].asDouble();
 	InitializeModel(sensitivity);
@@ -109,113 +230,161 @@ void Initialize()
 	for (int index = 0; index < animation.size(); ++index) {
 		frames.push_back(animation[index].asString());
 	}
-	InitializeAnimations(frames);
+	Animation::Options options;
+	options.atlas = config["atlas"].asBool();
+	options.npot  = config.get("npotTextures", true).asBool();
+	options.compressed = config.get("compressedTextures", true).asBool();
+	options.depth = config.get("textureDepth", 32).asInt();
+	options.streamingBudget = (long)(config.get("streamingBudgetMB", 0).asDouble() * 1024 * 1024);
+	options.cacheDirectory = config.get("textureCache", "").asString();
+	InitializeAnimations(frames, options);
+
+	g_FrameScheduler = new FrameScheduler();
+	g_FrameArena = new FrameArena(FRAME_ARENA_SIZE);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Rendering
 
-int GetFrameNumber(float x)
+// Returns the position in the animation, in frames, clamped to the first and last frame
+float GetFramePosition(float x)
 {
 	// x = 0..1
 	int frameCount = g_Animation->frameCount();
-	int frame = x * frameCount;
-	if (frame < 0)           { frame = 0; }
-	if (frame >= frameCount) { frame = frameCount - 1; }
-	return frame;
+	float position = x * frameCount;
+	if (position < 0.0f)           { position = 0.0f; }
+	if (position > frameCount - 1) { position = frameCount - 1; }
+	return position;
 }
 
-void RenderImage()
+void RenderImage(int frame, int nextFrame, float blend)
 {	
-	// Get animation frame
-	int frame = GetFrameNumber(g_Model->position());
-
-	// Get model coordinates
-	float vertexCoords[] = {
-		-1.0f, -1.0f, 0.0f,
-		-1.0f,  1.0f, 0.0f,
-		 1.0f, -1.0f, 0.0f,
-		 1.0f,  1.0f, 0.0f
-	};
-
-	// Clip texture to fill screen
-	float textureAspectRatio = g_Animation->aspectRatio(frame);
-	float screenAspectRatio = ((float)g_ScreenSurface->h) / ((float)g_ScreenSurface->w);
-
-	float wMin, wMax, hMin, hMax;
-	if (textureAspectRatio > screenAspectRatio) {
-		wMin = (1.0f - (screenAspectRatio / textureAspectRatio)) / 2;
-		wMax = (1.0f + (screenAspectRatio / textureAspectRatio)) / 2;
-		hMin = 0.0f;
-		hMax = 1.0f;
-	}
-	else {
-		wMin = 0.0f;
-		wMax = 1.0f;
-		hMin = (1.0f - (textureAspectRatio / screenAspectRatio)) / 2;
-		hMax = (1.0f + (screenAspectRatio / screenAspectRatio)) / 2;
-	}
-
-	// Crop texture border
-	float wSize = g_Animation->frameWCoord(frame);
-	float hSize = g_Animation->frameHCoord(frame);
-	wMin *= wSize;
-	wMax *= wSize;
-	hMin *= hSize;
-	hMax *= hSize;
-
-	// Get texture coordinates
-	float textureCoords[] = {
-		wMax, hMin,
-		wMin, hMin,
-		wMax, hMax,
-		wMin, hMax
-	};
-
-	// Set up modelview matrix
-	TransformationMatrix *modelviewMatrix = new TransformationMatrix();
+	PROFILE_SCOPE(PROFILE_RENDER_IMAGE);
 
 	// Bind shader
     g_Shader->bind();
 
 	// Bind texture
-	glActiveTexture(GL_TEXTURE0);
-	g_Animation->bindFrame(frame);
+	g_Animation->bindFrame(frame, 0);
 	
 	// Set up uniforms
-    int iProjectionMatrix = g_Shader->uniform("ProjectionMatrix");
-    int iModelviewMatrix  = g_Shader->uniform("ModelviewMatrix");
-	int iTexture          = g_Shader->uniform("Texture");
-    glUniformMatrix4fv(iProjectionMatrix, 1, false, g_ProjectionMatrix->getRawMatrix());
-    glUniformMatrix4fv(iModelviewMatrix, 1, false, modelviewMatrix->getRawMatrix());
-	glUniform1i(iTexture, 0);
-
-	// Bind coordinates
-    glVertexAttribPointer(Shader::ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, vertexCoords);
-	glEnableVertexAttribArray(Shader::ATTRIB_POSITION);
-    glVertexAttribPointer(Shader::ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, textureCoords);
-	glEnableVertexAttribArray(Shader::ATTRIB_TEXCOORD);
-
-	// Draw
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-	g_Shader->unbind();
+	g_Transform->upload(g_Shader, g_MVPUniform);
+	g_Shader->setUniform(g_TextureUniform, 0);
+
+	if (g_Crossfade) {
+		// Blend towards the next frame on the second texture unit
+		g_Animation->bindFrame(nextFrame, 1);
+		g_Shader->setUniform(g_NextTextureUniform, 1);
+		g_Shader->setUniform(g_FrameBlendUniform, blend);
+		g_ScreenQuad->draw(frame, nextFrame);
+	}
+	else {
+		// Draw the screen quad with the frame's texture coordinates
+		g_ScreenQuad->draw(frame);
+	}
+
+	// The shader stays bound for the next frame, unless the frame is upscaled
 }
 
 void Render()
 {
+	PROFILE_SCOPE(PROFILE_RENDER);
+
+	ModelState const& model = g_Pipeline->latestState();
+
+	unsigned int steps = model.step - g_LastStep;
+	if (steps == 0)     { ++g_RepeatedStepFrames; }
+	else if (steps > 1) { ++g_MultiStepFrames; }
+	g_LastStep = model.step;
+
+	RenderState state;
+	float position = GetFramePosition(model.x);
+	int frame = (int)position;
+	g_Animation->stream(frame, model.v);
+	std::vector<int> const& relaidOut = g_Animation->relaidOutFrames();
+	for (size_t i = 0; i < relaidOut.size(); ++i) {
+		g_ScreenQuad->updateFrame(relaidOut[i]);
+	}
+
+	state.frame  = g_Animation->residentFrame(frame);
+	state.nextFrame = state.frame;
+	state.blend  = 0;
+	if (g_Crossfade && frame + 1 < g_Animation->frameCount()) {
+		// Quantize the blend, so frames that would look the same are still skipped
+		state.nextFrame = g_Animation->residentFrame(frame + 1);
+		state.blend = (int)((position - frame) * 255.0f + 0.5f);
+	}
+
+	// Keep the last image up until a frame has streamed in
+	if (state.frame < 0 || state.nextFrame < 0) {
+		g_FrameScheduler->skipPresent();
+		return;
+	}
+
+	state.width  = g_ScreenSurface->w;
+	state.height = g_ScreenSurface->h;
+	state.scale  = g_RenderTarget != NULL ? g_RenderTarget->scale() : 1.0f;
+	state.shader = g_Shader->id();
+
+	// Skip all GL work if the displayed frame wouldn't change
+	if (!g_RenderInvalid && state == g_LastRenderState) {
+		++g_SkippedFrames;
+		g_FrameScheduler->skipPresent();
+		return;
+	}
+	g_LastRenderState = state;
+	g_RenderInvalid = false;
+	g_ScreenQuad->resize(state.width, state.height);
+	if (g_RenderTarget != NULL) {
+		g_RenderTarget->resize(state.width, state.height);
+		g_RenderTarget->begin();
+	}
+	++g_RenderedFrames;
+
     // Clear the screen
     glClear(GL_COLOR_BUFFER_BIT);
-	RenderImage();
-    SDL_GL_SwapBuffers();
+	RenderImage(state.frame, state.nextFrame, state.blend / 255.0f);
+
+	// Stretch a reduced-resolution frame over the screen
+	if (g_RenderTarget != NULL) {
+		g_RenderTarget->end();
+	}
+
+	g_FrameScheduler->beginPresent();
+	{
+		PROFILE_SCOPE(PROFILE_SWAP_BUFFERS);
+		SDL_GL_SwapBuffers();
+	}
+	g_FrameScheduler->endPresent();
+
+	// Trade resolution for frame rate when frames take too long
+	if (g_ResolutionGovernor != NULL
+		&& g_ResolutionGovernor->update(g_FrameScheduler->frameTime(), g_FrameScheduler->period()))
+	{
+		g_RenderTarget->setScale(g_ResolutionGovernor->scale());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Game logic
+// Statistics
 
-void Update(const int t, const int dt)
+void PrintStatistics()
 {
-	g_Model->tick(dt);
+	printf("Frames: %d rendered, %d skipped unchanged, %d missed deadlines, period %.2f ms\n",
+			g_RenderedFrames, g_SkippedFrames, g_FrameScheduler->missedDeadlines(),
+			Clock::toMilliseconds(g_FrameScheduler->period()));
+	printf("Timing: jitter %.3f ms mean, %.3f ms max; %d frames without a step, %d with multiple steps\n",
+			Clock::toMilliseconds(g_FrameScheduler->meanJitter()),
+			Clock::toMilliseconds(g_FrameScheduler->maxJitter()),
+			g_RepeatedStepFrames, g_MultiStepFrames);
+	printf("GL state: %u calls issued, %u redundant calls elided, %u matrix uploads\n",
+			GLState::callsIssued(), GLState::callsElided(), g_Transform->uploads());
+	printf("Memory: %d frames allocated from the heap; frame arena high water %u of %u bytes\n",
+			g_AllocatingFrames, (unsigned int)g_FrameArena->highWater(), (unsigned int)g_FrameArena->capacity());
+	if (g_RenderTarget != NULL) {
+		printf("Resolution: rendering at %.3f of %dx%d\n",
+				g_RenderTarget->scale(), g_ScreenSurface->w, g_ScreenSurface->h);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -228,86 +397,109 @@ int main(int argc, char** argv)
     SDL_Event Event;
     bool paused = false;
 
-	// Timestep variables
-	const unsigned int dt = 16; // Update physics at ~60fps
-	const unsigned int maxFrameTime = 250; // Slow down physics simulation if going slower than 4fps
-	unsigned int currentTime = SDL_GetTicks(),
-				 newTime = 0,
-				 frameTime = 0,
-				 accumulator = 0,
-				 t = 0;
+	PROFILE_INITIALIZE();
+
+	// Input and simulation run on their own threads from here on
+	g_Pipeline->start();
+
+	Clock::Nanoseconds lastStatistics = Clock::now();
 
     while (1) {
 
         /////////////////////////////////////////////////////////////////////////////
-        // Timing for game loop
+        // Frame pacing
 
-        newTime = SDL_GetTicks();
-        frameTime = newTime - currentTime;
-        if (frameTime > maxFrameTime) {
-            frameTime = maxFrameTime;
+        {
+            PROFILE_SCOPE(PROFILE_FRAME_WAIT);
+            g_FrameScheduler->waitForNextFrame();
         }
-        currentTime = newTime;
-        accumulator += frameTime;
 
-        while (accumulator >= dt) {
-            Update(t, dt);
-            accumulator -= dt;
-            t += dt;
-        }
+        // Transient objects of the previous frame are gone from here on
+        g_FrameArena->reset();
+        unsigned int allocations = AllocationCounter::threadCount();
 
         /////////////////////////////////////////////////////////////////////////////
         // Event handling
 		
-        bool gotEvent;
+        // Waiting while paused is idle time, so it stays out of the profile
+        bool gotEvent = false;
         if (paused) {
             SDL_WaitEvent(&Event);
             gotEvent = true;
         }
-        else {
-            gotEvent = SDL_PollEvent(&Event);
-        }
         
-        while (gotEvent) {
-            switch (Event.type) {
-                // List of keys that have been pressed
-                case SDL_KEYDOWN:
-                    switch (Event.key.keysym.sym) {
-                        case PDLK_GESTURE_BACK: /* also maps to ESC */
-                            if (PDL_GetPDKVersion() >= 200) {
-                                // standard behavior is to minimize to a card when you perform a back
-                                // gesture at the top level of the app
-                                PDL_Minimize();
+        {
+            PROFILE_SCOPE(PROFILE_EVENTS);
+
+            if (!gotEvent) {
+                gotEvent = SDL_PollEvent(&Event);
+            }
+            while (gotEvent) {
+                switch (Event.type) {
+                    // List of keys that have been pressed
+                    case SDL_KEYDOWN:
+                        switch (Event.key.keysym.sym) {
+                            case PDLK_GESTURE_BACK: /* also maps to ESC */
+                                if (PDL_GetPDKVersion() >= 200) {
+                                    // standard behavior is to minimize to a card when you perform a back
+                                    // gesture at the top level of the app
+                                    PDL_Minimize();
+                                }
+                                break;
+
+#ifdef PROFILING
+                            case SDLK_p:
+                                PROFILE_DUMP();
+                                break;
+#endif
+
+                            default:
+                                break;
+                        }
+                        break;
+
+                    case SDL_ACTIVEEVENT:
+                        if (Event.active.state == SDL_APPACTIVE) {
+                            paused = !Event.active.gain;
+                            g_Pipeline->setPaused(paused);
+                            if (!paused) {
+                                // The back buffer and GL state may not have survived being minimized
+                                GLState::invalidate();
+                                g_RenderInvalid = true;
+                                g_FrameScheduler->reset();
                             }
-                            break;
-
-                        default:
-                            break;
-                    }
-                    break;
-
-                case SDL_ACTIVEEVENT:
-                    if (Event.active.state == SDL_APPACTIVE) {
-                        paused = !Event.active.gain;
-                    }
-                    break;
-
-                case SDL_QUIT:
-                    // We exit anytime we get a request to quit the app
-                    // all shutdown code is registered via atexit() so this is clean.
-                    exit(0);
-                    break;
-
-                default:
-                    break;
+                        }
+                        break;
+
+                    case SDL_QUIT:
+                        // We exit anytime we get a request to quit the app
+                        // all shutdown code is registered via atexit() so this is clean,
+                        // once the worker threads are out of the way.
+                        g_Pipeline->stop();
+                        exit(0);
+                        break;
+
+                    default:
+                        break;
+                }
+                gotEvent = SDL_PollEvent(&Event);
             }
-            gotEvent = SDL_PollEvent(&Event);
         }
 
         /////////////////////////////////////////////////////////////////////////////
         // Rendering
 
         Render();
+
+        if (AllocationCounter::threadCount() != allocations) {
+            ++g_AllocatingFrames;
+        }
+
+        PROFILE_POLL();
+        if (Clock::now() - lastStatistics >= STATISTICS_INTERVAL) {
+            PrintStatistics();
+            lastStatistics = Clock::now();
+        }
     }
 
 	// What are you doing here?
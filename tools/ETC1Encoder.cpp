@@ -0,0 +1,258 @@
+#include "ETC1Encoder.h"
+
+#include <algorithm>
+#include <climits>
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+
+// Intensity modifiers for each table, as (small, large)
+static const int MODIFIER_TABLES[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+	{ 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Pixels of each half of a block, indexed as y * 4 + x
+static const int SUB_BLOCK_PIXELS[2][2][8] = {
+	// Side by side (flip = 0)
+	{ { 0, 4, 8, 12, 1, 5, 9, 13 }, { 2, 6, 10, 14, 3, 7, 11, 15 } },
+	// Stacked (flip = 1)
+	{ { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static int clamp255(int value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Returns the modifier applied by a pixel index: 0 -> +a, 1 -> +b, 2 -> -a, 3 -> -b
+static int modifierValue(int table, int index)
+{
+	int value = MODIFIER_TABLES[table][index & 1];
+	return (index & 2) ? -value : value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public methods
+
+void ETC1Encoder::encode(const unsigned char *pixels, int width, int height, std::vector<unsigned char> &output)
+{
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	output.resize(blocksWide * blocksHigh * 8);
+
+	unsigned char block[16 * 3];
+	unsigned char *out = &output[0];
+	for (int by = 0; by < blocksHigh; ++by) {
+		for (int bx = 0; bx < blocksWide; ++bx) {
+			// Gather the block, repeating the last row and column past the edges
+			for (int y = 0; y < 4; ++y) {
+				int sy = std::min(by * 4 + y, height - 1);
+				for (int x = 0; x < 4; ++x) {
+					int sx = std::min(bx * 4 + x, width - 1);
+					const unsigned char *source = pixels + (sy * width + sx) * 3;
+					unsigned char *dest = block + (y * 4 + x) * 3;
+					dest[0] = source[0];
+					dest[1] = source[1];
+					dest[2] = source[2];
+				}
+			}
+
+			// Blocks are stored big-endian
+			unsigned long long bits = encodeBlock(block);
+			for (int i = 7; i >= 0; --i) {
+				*out++ = (unsigned char)(bits >> (i * 8));
+			}
+		}
+	}
+}
+
+void ETC1Encoder::writePKMHeader(int width, int height, unsigned char *header)
+{
+	int paddedWidth = (width + 3) & ~3;
+	int paddedHeight = (height + 3) & ~3;
+
+	header[0] = 'P';
+	header[1] = 'K';
+	header[2] = 'M';
+	header[3] = ' ';
+	header[4] = '1';
+	header[5] = '0';
+	header[6] = 0;   // ETC1_RGB_NO_MIPMAPS
+	header[7] = 0;
+	header[8] = paddedWidth >> 8;
+	header[9] = paddedWidth & 0xFF;
+	header[10] = paddedHeight >> 8;
+	header[11] = paddedHeight & 0xFF;
+	header[12] = width >> 8;
+	header[13] = width & 0xFF;
+	header[14] = height >> 8;
+	header[15] = height & 0xFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private methods
+
+/*
+ * encodeBlock
+ * Compresses a 4x4 block of RGB pixels, stored row by row.
+ *
+ * Returns
+ *     The 64-bit ETC1 block.
+ */
+unsigned long long ETC1Encoder::encodeBlock(const unsigned char *block)
+{
+	unsigned long long bestBits = 0;
+	int bestError = INT_MAX;
+
+	for (int flip = 0; flip < 2; ++flip) {
+		// Average color of each half
+		int average[2][3];
+		for (int half = 0; half < 2; ++half) {
+			for (int c = 0; c < 3; ++c) {
+				int sum = 0;
+				for (int i = 0; i < 8; ++i) {
+					sum += block[SUB_BLOCK_PIXELS[flip][half][i] * 3 + c];
+				}
+				average[half][c] = (sum + 4) / 8;
+			}
+		}
+
+		for (int differential = 0; differential < 2; ++differential) {
+			// Quantize the base colors for this mode
+			int quantized[2][3];  // In the mode's own bit depth
+			int expanded[2][3];   // Expanded back to 8 bits
+			bool representable = true;
+			for (int c = 0; c < 3; ++c) {
+				if (differential) {
+					int base = (average[0][c] * 31 + 127) / 255;
+					int other = (average[1][c] * 31 + 127) / 255;
+					int delta = other - base;
+					if (delta < -4 || delta > 3) {
+						representable = false;
+						break;
+					}
+					quantized[0][c] = base;
+					quantized[1][c] = delta;
+					expanded[0][c] = (base << 3) | (base >> 2);
+					expanded[1][c] = (other << 3) | (other >> 2);
+				}
+				else {
+					for (int half = 0; half < 2; ++half) {
+						int value = (average[half][c] * 15 + 127) / 255;
+						quantized[half][c] = value;
+						expanded[half][c] = (value << 4) | value;
+					}
+				}
+			}
+			if (!representable) {
+				continue;
+			}
+
+			int tables[2];
+			int modifiers[16];
+			int error = 0;
+			for (int half = 0; half < 2; ++half) {
+				error += encodeSubBlock(block, SUB_BLOCK_PIXELS[flip][half], expanded[half], tables[half], modifiers);
+			}
+			if (error >= bestError) {
+				continue;
+			}
+			bestError = error;
+
+			// Assemble the block
+			unsigned long long bits = 0;
+			if (differential) {
+				bits |= (unsigned long long)quantized[0][0] << 59;
+				bits |= (unsigned long long)(quantized[1][0] & 7) << 56;
+				bits |= (unsigned long long)quantized[0][1] << 51;
+				bits |= (unsigned long long)(quantized[1][1] & 7) << 48;
+				bits |= (unsigned long long)quantized[0][2] << 43;
+				bits |= (unsigned long long)(quantized[1][2] & 7) << 40;
+			}
+			else {
+				bits |= (unsigned long long)quantized[0][0] << 60;
+				bits |= (unsigned long long)quantized[1][0] << 56;
+				bits |= (unsigned long long)quantized[0][1] << 52;
+				bits |= (unsigned long long)quantized[1][1] << 48;
+				bits |= (unsigned long long)quantized[0][2] << 44;
+				bits |= (unsigned long long)quantized[1][2] << 40;
+			}
+			bits |= (unsigned long long)tables[0] << 37;
+			bits |= (unsigned long long)tables[1] << 34;
+			bits |= (unsigned long long)differential << 33;
+			bits |= (unsigned long long)flip << 32;
+
+			// Pixel indices are stored column by column, most significant bits first
+			for (int y = 0; y < 4; ++y) {
+				for (int x = 0; x < 4; ++x) {
+					int index = modifiers[y * 4 + x];
+					int bit = x * 4 + y;
+					bits |= (unsigned long long)(index >> 1) << (16 + bit);
+					bits |= (unsigned long long)(index & 1) << bit;
+				}
+			}
+			bestBits = bits;
+		}
+	}
+
+	return bestBits;
+}
+
+/*
+ * encodeSubBlock
+ * Picks the modifier table and per-pixel modifiers for half of a block.
+ *
+ * Arguments
+ *     block:        The 4x4 block of RGB pixels.
+ *     pixelIndices: The 8 pixels of the half, indexed as y * 4 + x.
+ *     baseColor:    The half's base color, expanded to 8 bits.
+ *     table:        Receives the chosen modifier table.
+ *     modifiers:    Receives the modifier index of each pixel, indexed as y * 4 + x.
+ *
+ * Returns
+ *     The squared error of the half.
+ */
+int ETC1Encoder::encodeSubBlock(const unsigned char *block, const int *pixelIndices,
+								const int *baseColor, int &table, int *modifiers)
+{
+	int bestError = INT_MAX;
+	int bestModifiers[8] = { 0 };
+
+	for (int t = 0; t < 8; ++t) {
+		int error = 0;
+		int chosen[8];
+		for (int i = 0; i < 8 && error < bestError; ++i) {
+			const unsigned char *pixel = block + pixelIndices[i] * 3;
+
+			int bestPixelError = INT_MAX;
+			for (int m = 0; m < 4; ++m) {
+				int modifier = modifierValue(t, m);
+				int pixelError = 0;
+				for (int c = 0; c < 3; ++c) {
+					int difference = clamp255(baseColor[c] + modifier) - pixel[c];
+					pixelError += difference * difference;
+				}
+				if (pixelError < bestPixelError) {
+					bestPixelError = pixelError;
+					chosen[i] = m;
+				}
+			}
+			error += bestPixelError;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			table = t;
+			std::copy(chosen, chosen + 8, bestModifiers);
+		}
+	}
+
+	for (int i = 0; i < 8; ++i) {
+		modifiers[pixelIndices[i]] = bestModifiers[i];
+	}
+	return bestError;
+}
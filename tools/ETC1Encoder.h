@@ -0,0 +1,38 @@
+#ifndef __ETC1ENCODER_H__
+#define __ETC1ENCODER_H__
+
+#include <vector>
+
+/*
+ * ETC1Encoder
+ * Compresses RGB images to ETC1, for use with GL_OES_compressed_ETC1_RGB8_texture.
+ *
+ * Every block is tried in both split orientations, in both individual and
+ * differential mode, with every modifier table; the combination with the
+ * least squared error is kept.
+ */
+class ETC1Encoder {
+	public:
+		// Compresses an image.
+		// Arguments
+		//		pixels: Tightly packed 8-bit RGB pixels
+		//		width:  Width of the image
+		//		height: Height of the image
+		//		output: Receives the compressed blocks. The image is padded to a
+		//		        multiple of 4 in both dimensions by repeating its edges.
+		static void encode(const unsigned char *pixels, int width, int height, std::vector<unsigned char> &output);
+
+		// Writes a PKM file header for an image.
+		// Arguments
+		//		width:  Width of the original image
+		//		height: Height of the original image
+		//		header: Receives the 16 header bytes
+		static void writePKMHeader(int width, int height, unsigned char *header);
+
+	private:
+		static unsigned long long encodeBlock(const unsigned char *block);
+		static int encodeSubBlock(const unsigned char *block, const int *pixelIndices,
+								  const int *baseColor, int &table, int *modifiers);
+};
+
+#endif
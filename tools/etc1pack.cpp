@@ -0,0 +1,139 @@
+/*
+ * etc1pack
+ * Converts animation frames to ETC1-compressed PKM files.
+ *
+ * Usage
+ *     etc1pack <config.json | image>...
+ *
+ * For a config file, every frame of its "animation" list is converted; frame
+ * paths are relative to the config file. Each image "name.ext" is written to
+ * "name.pkm" next to it, where the app picks it up in place of the image.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_image.h"
+
+#include "json/value.h"
+
+#include "ETC1Encoder.h"
+#include "Exceptions.h"
+#include "FileIO.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// Returns the directory part of a path, including the trailing slash.
+static std::string directoryOf(std::string const& filename)
+{
+	size_t slash = filename.find_last_of('/');
+	return slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+/*
+ * convertImage
+ * Compresses one image to a PKM file.
+ *
+ * Returns
+ *     false if the image couldn't be read or the PKM file couldn't be written.
+ */
+static bool convertImage(std::string const& filename)
+{
+	SDL_Surface *surface = IMG_Load(filename.c_str());
+	if (surface == NULL) {
+		fprintf(stderr, "Can't load %s: %s\n", filename.c_str(), IMG_GetError());
+		return false;
+	}
+
+	// Unpack to tightly packed RGB, whatever the surface format
+	std::vector<unsigned char> pixels(surface->w * surface->h * 3);
+	SDL_LockSurface(surface);
+	int bytesPerPixel = surface->format->BytesPerPixel;
+	for (int y = 0; y < surface->h; ++y) {
+		const unsigned char *row = (const unsigned char *)surface->pixels + y * surface->pitch;
+		for (int x = 0; x < surface->w; ++x) {
+			Uint32 pixel = 0;
+			memcpy(&pixel, row + x * bytesPerPixel, bytesPerPixel);
+			unsigned char *rgb = &pixels[(y * surface->w + x) * 3];
+			SDL_GetRGB(pixel, surface->format, &rgb[0], &rgb[1], &rgb[2]);
+		}
+	}
+	SDL_UnlockSurface(surface);
+
+	std::vector<unsigned char> blocks;
+	ETC1Encoder::encode(&pixels[0], surface->w, surface->h, blocks);
+
+	unsigned char header[16];
+	ETC1Encoder::writePKMHeader(surface->w, surface->h, header);
+
+	std::string outputFilename = FileIO::replaceExtension(filename, ".pkm");
+	FILE *file = fopen(outputFilename.c_str(), "wb");
+	bool success = file != NULL
+		&& fwrite(header, 1, sizeof(header), file) == sizeof(header)
+		&& fwrite(&blocks[0], 1, blocks.size(), file) == blocks.size();
+	if (file != NULL) {
+		success = fclose(file) == 0 && success;
+	}
+
+	if (success) {
+		printf("%s -> %s (%dx%d, %d bytes)\n", filename.c_str(), outputFilename.c_str(),
+				surface->w, surface->h, (int)(blocks.size() + sizeof(header)));
+	}
+	else {
+		fprintf(stderr, "Can't write %s\n", outputFilename.c_str());
+	}
+
+	SDL_FreeSurface(surface);
+	return success;
+}
+
+/*
+ * convertConfig
+ * Compresses every animation frame listed in a config file.
+ */
+static bool convertConfig(std::string const& filename)
+{
+	Json::Value config;
+	try {
+		config = FileIO::loadJSON(filename);
+	}
+	catch (JsonParseException const& e) {
+		fprintf(stderr, "Can't parse %s: %s\n", filename.c_str(), e.what());
+		return false;
+	}
+
+	std::string directory = directoryOf(filename);
+	Json::Value animation = config["animation"];
+	bool success = true;
+	for (int index = 0; index < animation.size(); ++index) {
+		success = convertImage(directory + animation[index].asString()) && success;
+	}
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Main
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <config.json | image>...\n", argv[0]);
+		return 2;
+	}
+
+	bool success = true;
+	for (int i = 1; i < argc; ++i) {
+		std::string filename = argv[i];
+		bool isConfig = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+		success = (isConfig ? convertConfig(filename) : convertImage(filename)) && success;
+	}
+
+	return success ? 0 : 1;
+}
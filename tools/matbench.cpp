@@ -0,0 +1,406 @@
+/*
+ * matbench
+ * Checks the TransformationMatrix operations against plain scalar versions
+ * of them, then times both.
+ *
+ * Usage
+ *     matbench [iterations]
+ *
+ * The scalar versions are the element-by-element code TransformationMatrix
+ * used before it worked on whole columns. Build it for the device as well as
+ * the host, since the SIMD path depends on the target.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Clock.h"
+#include "TransformationMatrix.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar reference
+
+/*
+ * ScalarMatrix
+ * The element-by-element implementation, stored the same way.
+ */
+struct ScalarMatrix {
+	float matrix[4][4];
+
+	ScalarMatrix()
+	{
+		memset(matrix, 0, sizeof(matrix));
+		matrix[0][0] = matrix[1][1] = matrix[2][2] = matrix[3][3] = 1.0f;
+	}
+
+	void translate(float x, float y, float z)
+	{
+		for (int column = 0; column < 4; ++column) {
+			matrix[column][0] += x * matrix[column][3];
+			matrix[column][1] += y * matrix[column][3];
+			matrix[column][2] += z * matrix[column][3];
+		}
+	}
+
+	void rotateZ(float angle)
+	{
+		float tmp[4][2];
+		for (int column = 0; column < 4; ++column) {
+			tmp[column][0] = cos(angle) * matrix[column][0] - sin(angle) * matrix[column][1];
+			tmp[column][1] = sin(angle) * matrix[column][0] + cos(angle) * matrix[column][1];
+		}
+		for (int column = 0; column < 4; ++column) {
+			matrix[column][0] = tmp[column][0];
+			matrix[column][1] = tmp[column][1];
+		}
+	}
+
+	void scale(float sX, float sY, float sZ)
+	{
+		for (int column = 0; column < 4; ++column) {
+			matrix[column][0] *= sX;
+			matrix[column][1] *= sY;
+			matrix[column][2] *= sZ;
+		}
+	}
+
+	void multiply(ScalarMatrix const& lhs, ScalarMatrix const& rhs)
+	{
+		for (int column = 0; column < 4; ++column) {
+			for (int row = 0; row < 4; ++row) {
+				matrix[column][row] = lhs.matrix[0][row] * rhs.matrix[column][0]
+					+ lhs.matrix[1][row] * rhs.matrix[column][1]
+					+ lhs.matrix[2][row] * rhs.matrix[column][2]
+					+ lhs.matrix[3][row] * rhs.matrix[column][3];
+			}
+		}
+	}
+
+	void transformPoints(const float *points, float *results, int count) const
+	{
+		for (int i = 0; i < count; ++i, points += 3, results += 3) {
+			float x = points[0], y = points[1], z = points[2];
+			for (int row = 0; row < 3; ++row) {
+				results[row] = matrix[0][row] * x + matrix[1][row] * y + matrix[2][row] * z + matrix[3][row];
+			}
+		}
+	}
+
+	const float *getRawMatrix() const { return &matrix[0][0]; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// Keeps results alive, so the timed loops aren't optimized away
+static volatile float g_Sink;
+
+// Returns the largest difference between two sets of elements.
+static float maxDifference(const float *a, const float *b, int count)
+{
+	float difference = 0.0f;
+	for (int i = 0; i < count; ++i) {
+		float d = fabsf(a[i] - b[i]);
+		if (d > difference) {
+			difference = d;
+		}
+	}
+	return difference;
+}
+
+// Prints one line of results, with times per call in nanoseconds.
+static void report(const char *name, Clock::Nanoseconds scalar, Clock::Nanoseconds kernel, int calls)
+{
+	double scalarTime = (double)scalar / calls;
+	double kernelTime = (double)kernel / calls;
+	if (scalar > 0) {
+		printf("%-18s %9.1f ns %9.1f ns %7.2fx\n",
+				name, scalarTime, kernelTime, scalarTime / kernelTime);
+	}
+	else {
+		printf("%-18s %12s %9.1f ns\n", name, "-", kernelTime);
+	}
+}
+
+// Fills a matrix pair with the same arbitrary affine transformation.
+static void setUp(TransformationMatrix &matrix, ScalarMatrix &scalar, float seed)
+{
+	matrix.scale(1.0f + seed, 2.0f - seed, 1.5f);
+	matrix.rotateZ(seed * 3.0f);
+	matrix.translate(seed, -seed, 0.5f);
+	scalar.scale(1.0f + seed, 2.0f - seed, 1.5f);
+	scalar.rotateZ(seed * 3.0f);
+	scalar.translate(seed, -seed, 0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks
+
+/*
+ * checkOperations
+ * Compares single operations with the scalar reference, and the operations
+ * without a scalar version with what they should equal.
+ *
+ * Returns
+ *     false if any result is off by more than rounding.
+ */
+static bool checkOperations()
+{
+	const float TOLERANCE = 1e-5f;
+	bool passed = true;
+
+	TransformationMatrix a, b, matrix, expected;
+	ScalarMatrix scalarA, scalarB, scalar;
+	setUp(a, scalarA, 0.25f);
+	setUp(b, scalarB, 0.75f);
+
+	const int CHECKS = 11;
+	float differences[CHECKS];
+	const char *names[CHECKS] = {
+		"multiply", "rotateZ", "translate", "scale",
+		"postRotateZ", "postTranslate", "transpose", "invertAffine",
+		"multiply general", "constant translate", "constant scale"
+	};
+
+	matrix.multiply(a, b);
+	scalar.multiply(scalarA, scalarB);
+	differences[0] = maxDifference(matrix.getRawMatrix(), scalar.getRawMatrix(), 16);
+
+	matrix = a;
+	scalar = scalarA;
+	matrix.rotateZ(0.7f);
+	scalar.rotateZ(0.7f);
+	differences[1] = maxDifference(matrix.getRawMatrix(), scalar.getRawMatrix(), 16);
+
+	matrix = a;
+	scalar = scalarA;
+	matrix.translate(0.3f, -0.2f, 0.1f);
+	scalar.translate(0.3f, -0.2f, 0.1f);
+	differences[2] = maxDifference(matrix.getRawMatrix(), scalar.getRawMatrix(), 16);
+
+	matrix = a;
+	scalar = scalarA;
+	matrix.scale(1.5f, 0.5f, 2.0f);
+	scalar.scale(1.5f, 0.5f, 2.0f);
+	differences[3] = maxDifference(matrix.getRawMatrix(), scalar.getRawMatrix(), 16);
+
+	// Post-multiplying matches multiplying by the transformation on the right
+	TransformationMatrix transformation;
+	transformation.rotateZ(0.7f);
+	matrix = a;
+	matrix.postRotateZ(0.7f);
+	expected.multiply(a, transformation);
+	differences[4] = maxDifference(matrix.getRawMatrix(), expected.getRawMatrix(), 16);
+
+	transformation.identityMatrix();
+	transformation.translate(0.3f, -0.2f, 0.1f);
+	matrix = a;
+	matrix.postTranslate(0.3f, -0.2f, 0.1f);
+	expected.multiply(a, transformation);
+	differences[5] = maxDifference(matrix.getRawMatrix(), expected.getRawMatrix(), 16);
+
+	// Transposing moves every element across the diagonal
+	matrix = a;
+	matrix.transpose();
+	differences[6] = 0.0f;
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			float d = fabsf(matrix.element(row, column) - a.element(column, row));
+			differences[6] = d > differences[6] ? d : differences[6];
+		}
+	}
+
+	// The inverse undoes the matrix
+	matrix = a;
+	passed = matrix.invertAffine() && passed;
+	expected.multiply(a, matrix);
+	matrix.identityMatrix();
+	differences[7] = maxDifference(expected.getRawMatrix(), matrix.getRawMatrix(), 16);
+
+	// A projective rhs takes the general path
+	TransformationMatrix projection;
+	ScalarMatrix scalarProjection;
+	projection.perspectiveMatrix(480.0f, 320.0f, 70.0f, 0.1f, 200.0f);
+	memcpy(scalarProjection.matrix, projection.getRawMatrix(), sizeof(scalarProjection.matrix));
+	matrix.multiply(a, projection);
+	scalar.multiply(scalarA, scalarProjection);
+	differences[8] = maxDifference(matrix.getRawMatrix(), scalar.getRawMatrix(), 16);
+
+	// Constants match the same transformation of the identity
+	static const TransformationMatrix::Constant TRANSLATION = TRANSFORMATION_TRANSLATE(0.3f, -0.2f, 0.1f);
+	static const TransformationMatrix::Constant SCALE = TRANSFORMATION_SCALE(1.5f, 0.5f, 2.0f);
+	matrix = TRANSLATION;
+	expected.identityMatrix();
+	expected.translate(0.3f, -0.2f, 0.1f);
+	differences[9] = maxDifference(matrix.getRawMatrix(), expected.getRawMatrix(), 16);
+
+	matrix = SCALE;
+	expected.identityMatrix();
+	expected.scale(1.5f, 0.5f, 2.0f);
+	differences[10] = maxDifference(matrix.getRawMatrix(), expected.getRawMatrix(), 16);
+
+	for (int i = 0; i < CHECKS; ++i) {
+		bool ok = differences[i] <= TOLERANCE;
+		printf("%-18s max difference %g%s\n", names[i], differences[i], ok ? "" : "  FAILED");
+		passed = passed && ok;
+	}
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+int main(int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+	if (iterations <= 0) {
+		fprintf(stderr, "Usage: matbench [iterations]\n");
+		return 1;
+	}
+
+#if defined(__SSE__)
+	printf("Kernels: SSE\n");
+#elif defined(__ARM_NEON__)
+	printf("Kernels: NEON\n");
+#else
+	printf("Kernels: portable\n");
+#endif
+	bool passed = checkOperations();
+
+	printf("\n%-18s %12s %12s %8s\n", "", "scalar", "columns", "speedup");
+
+	TransformationMatrix a, forward, back, result;
+	ScalarMatrix scalarA, scalarForward, scalarBack, scalarResult;
+	setUp(a, scalarA, 0.25f);
+	forward.rotateZ(0.01f);
+	back.rotateZ(-0.01f);
+	scalarForward.rotateZ(0.01f);
+	scalarBack.rotateZ(-0.01f);
+
+	// multiply: chain each product into the next, so no call can be skipped,
+	// rotating back and forth to keep the values bounded
+	Clock::Nanoseconds start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		scalarResult.multiply(scalarA, scalarForward);
+		scalarA.multiply(scalarResult, scalarBack);
+	}
+	Clock::Nanoseconds scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		result.multiply(a, forward);
+		a.multiply(result, back);
+	}
+	Clock::Nanoseconds kernelTime = Clock::now() - start;
+	report("multiply", scalarTime, kernelTime, iterations * 2);
+
+	// The same with a projective rhs, which can't skip its bottom row
+	TransformationMatrix projection;
+	ScalarMatrix scalarProjection;
+	projection.perspectiveMatrix(480.0f, 320.0f, 70.0f, 0.1f, 200.0f);
+	memcpy(scalarProjection.matrix, projection.getRawMatrix(), sizeof(scalarProjection.matrix));
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		scalarResult.multiply(scalarA, scalarProjection);
+		g_Sink = scalarResult.matrix[3][2];
+	}
+	scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		result.multiply(a, projection);
+		g_Sink = result.element(2, 3);
+	}
+	kernelTime = Clock::now() - start;
+	report("multiply general", scalarTime, kernelTime, iterations);
+
+	// Small, alternating steps keep the chained matrices bounded
+	TransformationMatrix matrix;
+	ScalarMatrix scalar;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		scalar.rotateZ((i & 1) ? 0.001f : -0.0005f);
+	}
+	scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		matrix.rotateZ((i & 1) ? 0.001f : -0.0005f);
+	}
+	kernelTime = Clock::now() - start;
+	report("rotateZ", scalarTime, kernelTime, iterations);
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		scalar.translate((i & 1) ? 0.001f : -0.001f, 0.0005f, 0.0f);
+	}
+	scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		matrix.translate((i & 1) ? 0.001f : -0.001f, 0.0005f, 0.0f);
+	}
+	kernelTime = Clock::now() - start;
+	report("translate", scalarTime, kernelTime, iterations);
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		float s = (i & 1) ? 1.001f : 1.0f / 1.001f;
+		scalar.scale(s, s, 1.0f);
+	}
+	scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		float s = (i & 1) ? 1.001f : 1.0f / 1.001f;
+		matrix.scale(s, s, 1.0f);
+	}
+	kernelTime = Clock::now() - start;
+	report("scale", scalarTime, kernelTime, iterations);
+
+	// transformPoints: a batch the size of a small mesh
+	const int POINT_COUNT = 1024;
+	int batches = iterations / POINT_COUNT + 1;
+	std::vector<float> points(POINT_COUNT * 3), scalarPoints(POINT_COUNT * 3), kernelPoints(POINT_COUNT * 3);
+	for (int i = 0; i < POINT_COUNT * 3; ++i) {
+		points[i] = (float)(i % 97) / 97.0f - 0.5f;
+	}
+
+	start = Clock::now();
+	for (int i = 0; i < batches; ++i) {
+		scalarA.transformPoints(&points[0], &scalarPoints[0], POINT_COUNT);
+		g_Sink = scalarPoints[i % (POINT_COUNT * 3)];
+	}
+	scalarTime = Clock::now() - start;
+
+	start = Clock::now();
+	for (int i = 0; i < batches; ++i) {
+		a.transformPoints(&points[0], &kernelPoints[0], POINT_COUNT);
+		g_Sink = kernelPoints[i % (POINT_COUNT * 3)];
+	}
+	kernelTime = Clock::now() - start;
+	report("transformPoints", scalarTime, kernelTime, batches * POINT_COUNT);
+
+	// Operations the scalar code didn't have
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		matrix.transpose();
+	}
+	report("transpose", 0, Clock::now() - start, iterations);
+
+	TransformationMatrix inverse;
+	start = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		inverse = a;
+		inverse.invertAffine();
+		g_Sink = inverse.getRawMatrix()[i & 15];
+	}
+	report("invertAffine", 0, Clock::now() - start, iterations);
+
+	return passed ? 0 : 1;
+}
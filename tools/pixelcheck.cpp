@@ -0,0 +1,207 @@
+/*
+ * pixelcheck
+ * Checks PixelConverter against a plain per-pixel version of its
+ * conversions, then times both.
+ *
+ * Usage
+ *     pixelcheck [iterations]
+ *
+ * The per-pixel versions are the loops PixelConverter finishes rows with.
+ * Build it for the device as well as the host, since the word and NEON
+ * paths depend on the target.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Clock.h"
+#include "PixelConverter.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-pixel reference
+
+static const unsigned char BAYER[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 }
+};
+
+static inline unsigned int saturate(unsigned int value)
+{
+	return value > 255 ? 255 : value;
+}
+
+static void referenceRGB565(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height)
+{
+	for (int y = 0; y < height; ++y, src += srcPitch, dst += width) {
+		for (int x = 0; x < width; ++x) {
+			const unsigned char *pixel = src + x * 3;
+			unsigned int threshold = BAYER[y & 3][x & 3];
+			unsigned int r = saturate(pixel[0] + (threshold >> 1)) >> 3;
+			unsigned int g = saturate(pixel[1] + (threshold >> 2)) >> 2;
+			unsigned int b = saturate(pixel[2] + (threshold >> 1)) >> 3;
+			dst[x] = (unsigned short)(r << 11 | g << 5 | b);
+		}
+	}
+}
+
+static void referenceRGBA4444(const unsigned char *src, int srcPitch, unsigned short *dst, int width, int height)
+{
+	for (int y = 0; y < height; ++y, src += srcPitch, dst += width) {
+		for (int x = 0; x < width; ++x) {
+			const unsigned char *pixel = src + x * 4;
+			unsigned int threshold = BAYER[y & 3][x & 3];
+			unsigned int r = saturate(pixel[0] + threshold) >> 4;
+			unsigned int g = saturate(pixel[1] + threshold) >> 4;
+			unsigned int b = saturate(pixel[2] + threshold) >> 4;
+			unsigned int a = saturate(pixel[3] + threshold) >> 4;
+			dst[x] = (unsigned short)(r << 12 | g << 8 | b << 4 | a);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// Keeps results alive, so the timed loops aren't optimized away
+static volatile unsigned short g_Sink;
+
+// Fills pixels with random values, weighted towards 255 so saturation is
+// exercised.
+static void fillPixels(std::vector<unsigned char> &pixels)
+{
+	for (size_t i = 0; i < pixels.size(); ++i) {
+		int value = rand() % 320;
+		pixels[i] = (unsigned char)(value > 255 ? 255 : value);
+	}
+}
+
+// Returns the row pitch SDL would give a surface: whole words.
+static int surfacePitch(int width, int bytesPerPixel)
+{
+	return (width * bytesPerPixel + 3) & ~3;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks
+
+/*
+ * checkConversions
+ * Converts images of every width up to 67 pixels, at word-aligned and
+ * unaligned addresses, and compares them with the reference.
+ *
+ * Returns
+ *     false if any texel differs.
+ */
+static bool checkConversions()
+{
+	int mismatches565 = 0;
+	int mismatches4444 = 0;
+	const int HEIGHT = 5;
+
+	for (int width = 1; width <= 67; ++width) {
+		for (int offset = 0; offset < 2; ++offset) {
+			for (int bytesPerPixel = 3; bytesPerPixel <= 4; ++bytesPerPixel) {
+				int pitch = surfacePitch(width, bytesPerPixel);
+				std::vector<unsigned char> pixels(pitch * HEIGHT + 4);
+				fillPixels(pixels);
+				const unsigned char *src = &pixels[offset];
+
+				std::vector<unsigned short> expected(width * HEIGHT);
+				std::vector<unsigned short> texels(width * HEIGHT);
+				if (bytesPerPixel == 3) {
+					referenceRGB565(src, pitch, &expected[0], width, HEIGHT);
+					PixelConverter::toRGB565(src, pitch, &texels[0], width, HEIGHT);
+				}
+				else {
+					referenceRGBA4444(src, pitch, &expected[0], width, HEIGHT);
+					PixelConverter::toRGBA4444(src, pitch, &texels[0], width, HEIGHT);
+				}
+
+				int &mismatches = bytesPerPixel == 3 ? mismatches565 : mismatches4444;
+				for (size_t i = 0; i < texels.size(); ++i) {
+					if (texels[i] != expected[i]) {
+						++mismatches;
+					}
+				}
+			}
+		}
+	}
+
+	printf("%-18s %d texels differ%s\n", "RGB565", mismatches565, mismatches565 ? "  FAILED" : "");
+	printf("%-18s %d texels differ%s\n", "RGBA4444", mismatches4444, mismatches4444 ? "  FAILED" : "");
+	return mismatches565 == 0 && mismatches4444 == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+// Prints one line of results, with times per image in milliseconds.
+static void report(const char *name, Clock::Nanoseconds reference, Clock::Nanoseconds converter, int calls)
+{
+	double referenceTime = Clock::toMilliseconds(reference) / calls;
+	double converterTime = Clock::toMilliseconds(converter) / calls;
+	printf("%-18s %9.2f ms %9.2f ms %7.2fx\n",
+			name, referenceTime, converterTime, referenceTime / converterTime);
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20;
+	if (iterations < 1) {
+		iterations = 1;
+	}
+
+#if defined(__ARM_NEON__)
+	printf("Rows: NEON\n");
+#elif (defined(__ARM_ARCH_6__) || defined(__ARM_ARCH_6J__) || defined(__ARM_ARCH_6K__) \
+		|| defined(__ARM_ARCH_6Z__) || defined(__ARM_ARCH_6ZK__)) && !defined(__thumb__) \
+		|| defined(__ARM_ARCH_7A__)
+	printf("Rows: ARMv6 SIMD words\n");
+#else
+	printf("Rows: portable words\n");
+#endif
+	bool passed = checkConversions();
+
+	// A screen-sized frame
+	const int WIDTH = 480, HEIGHT = 320;
+	printf("\n%-18s %12s %12s %8s\n", "", "per pixel", "converter", "speedup");
+
+	for (int bytesPerPixel = 3; bytesPerPixel <= 4; ++bytesPerPixel) {
+		int pitch = surfacePitch(WIDTH, bytesPerPixel);
+		std::vector<unsigned char> pixels(pitch * HEIGHT);
+		fillPixels(pixels);
+		std::vector<unsigned short> texels(WIDTH * HEIGHT);
+
+		Clock::Nanoseconds start = Clock::now();
+		for (int i = 0; i < iterations; ++i) {
+			if (bytesPerPixel == 3) {
+				referenceRGB565(&pixels[0], pitch, &texels[0], WIDTH, HEIGHT);
+			}
+			else {
+				referenceRGBA4444(&pixels[0], pitch, &texels[0], WIDTH, HEIGHT);
+			}
+			g_Sink = texels[i % texels.size()];
+		}
+		Clock::Nanoseconds referenceTime = Clock::now() - start;
+
+		start = Clock::now();
+		for (int i = 0; i < iterations; ++i) {
+			if (bytesPerPixel == 3) {
+				PixelConverter::toRGB565(&pixels[0], pitch, &texels[0], WIDTH, HEIGHT);
+			}
+			else {
+				PixelConverter::toRGBA4444(&pixels[0], pitch, &texels[0], WIDTH, HEIGHT);
+			}
+			g_Sink = texels[i % texels.size()];
+		}
+		Clock::Nanoseconds converterTime = Clock::now() - start;
+
+		report(bytesPerPixel == 3 ? "RGB565" : "RGBA4444", referenceTime, converterTime, iterations);
+	}
+
+	return passed ? 0 : 1;
+}